@@ -17,10 +17,20 @@ SOURCES += main.cpp\
     types.cpp \
     category.cpp \
     object.cpp \
-    bboxdelegate.cpp \
+    timelineview.cpp \
     scrollarea.cpp \
     idcounter.cpp \
-    julia.cpp
+    julia.cpp \
+    framedecoder.cpp \
+    framecache.cpp \
+    keyframeindex.cpp \
+    glextensions.cpp \
+    bboxgrid.cpp \
+    lifespanindex.cpp \
+    objectstore.cpp \
+    journal.cpp \
+    btdfile.cpp \
+    filesync.cpp
 
 HEADERS  += mainwindow.h \
     videowidget.h \
@@ -28,10 +38,20 @@ HEADERS  += mainwindow.h \
     types.h \
     category.h \
     object.h \
-    bboxdelegate.h \
+    timelineview.h \
     scrollarea.h \
     idcounter.h \
-    julia.h
+    julia.h \
+    framedecoder.h \
+    framecache.h \
+    keyframeindex.h \
+    glextensions.h \
+    bboxgrid.h \
+    lifespanindex.h \
+    objectstore.h \
+    journal.h \
+    btdfile.h \
+    filesync.h
 
 win32:{LIBS += -lopencv_highgui242 \
                -lopencv_core242}
@@ -40,6 +60,10 @@ unix:LIBS += "-L/usr/local/lib" -lopencv_core -lopencv_highgui
 unix:{INCLUDEPATH += /usr/local/include/opencv2/
       INCLUDEPATH += /usr/local/include/opencv2/core}
 
+# interpolateSegment() has to match interpolate() bit by bit, so products and
+# sums must not get fused into FMA instructions in one of them only
+*-g++*|*-clang*:QMAKE_CXXFLAGS += -ffp-contract=off
+
 RESOURCES += icons.qrc
 
 OTHER_FILES += \
@@ -0,0 +1,92 @@
+#include "bboxgrid.h"
+#include <cmath>
+
+BBoxGrid::BBoxGrid() :
+   cellSize(1),
+   columns(0),
+   rows(0)
+{
+}
+
+/** Returns -1 if \a pos lies outside of the grid.
+  */
+int BBoxGrid::boxAt(QPoint const & pos) const {
+   if (!bounds.contains(pos)) {
+      return -1;
+   }
+   const int cell = (pos.y()-bounds.top())/cellSize*columns + (pos.x()-bounds.left())/cellSize;
+   for (int i=cellStarts.at(cell+1)-1; i>=cellStarts.at(cell); --i) {
+      const int box = cellItems.at(i);
+      if (rects.at(box).contains(pos)) {
+         return box;
+      }
+   }
+   return -1;
+}
+
+/** The cells get filled in two passes, first counting the boxes per cell and
+  * then storing their indices, so no per cell lists get allocated.
+  */
+void BBoxGrid::build(QList<BBox> const & bboxes) {
+   clear();
+   rects.reserve(bboxes.size());
+   foreach (BBox const & bbox, bboxes) {
+      const QRect rect = bbox.rect.normalized();
+      rects << rect;
+      bounds |= rect;
+   }
+   if (bounds.isEmpty()) {
+      return;
+   }
+
+   const double area = double(bounds.width())*bounds.height();
+   cellSize = qMax(8, int(std::ceil(std::sqrt(area/rects.size()))));
+   columns = (bounds.width()+cellSize-1)/cellSize;
+   rows = (bounds.height()+cellSize-1)/cellSize;
+
+   cellStarts.fill(0, columns*rows+1);
+   for (int pass=0; pass<2; ++pass) {
+      for (int box=0; box<rects.size(); ++box) {
+         QRect const & rect = rects.at(box);
+         if (rect.isEmpty()) {
+            continue;
+         }
+         const int firstColumn = (rect.left()-bounds.left())/cellSize;
+         const int lastColumn = (rect.right()-bounds.left())/cellSize;
+         const int firstRow = (rect.top()-bounds.top())/cellSize;
+         const int lastRow = (rect.bottom()-bounds.top())/cellSize;
+         for (int row=firstRow; row<=lastRow; ++row) {
+            for (int column=firstColumn; column<=lastColumn; ++column) {
+               const int cell = row*columns+column;
+               if (pass == 0) {
+                  ++cellStarts[cell+1];
+               }
+               else {
+                  // the start of the next cell is used as insert position and ends as this cell's end
+                  cellItems[cellStarts[cell+1]++] = box;
+               }
+            }
+         }
+      }
+      if (pass == 0) {
+         for (int cell=0; cell<columns*rows; ++cell) {
+            cellStarts[cell+1] += cellStarts[cell];
+         }
+         cellItems.resize(cellStarts.last());
+         // shift the starts by one cell, the fill pass moves them to the ends
+         for (int cell=columns*rows; cell>0; --cell) {
+            cellStarts[cell] = cellStarts[cell-1];
+         }
+      }
+   }
+}
+
+void BBoxGrid::clear() {
+   rects.clear();
+   bounds = QRect();
+   cellSize = 1;
+   columns = 0;
+   rows = 0;
+   cellStarts.clear();
+   cellItems.clear();
+}
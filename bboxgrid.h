@@ -0,0 +1,39 @@
+#ifndef BBOXGRID_H
+#define BBOXGRID_H
+
+#include <QtCore/QList>
+#include <QtCore/QPoint>
+#include <QtCore/QRect>
+#include <QtCore/QVector>
+#include "types.h"
+
+/// Uniform grid over the bounding boxes of a frame for fast hit testing.
+/** The area covered by the boxes is divided into square cells, each holding
+  * the indices of the boxes overlapping it. The cell size is chosen so there
+  * are about as many cells as boxes, so a point query only has to test the few
+  * boxes of a single cell. The indices of a cell are stored contiguously and in
+  * ascending order, so the topmost (last drawn) box is found first.
+  */
+class BBoxGrid {
+
+public:
+   /// Creates an empty grid.
+   BBoxGrid();
+   /// Builds the grid over the given \a bboxes.
+   void build(QList<BBox> const & bboxes);
+   /// Removes all boxes.
+   void clear();
+   /// Returns the index of the topmost box containing \a pos or -1.
+   int boxAt(QPoint const & pos) const;
+
+private:
+   QVector<QRect> rects;     ///< Geometry of the boxes in the order of the list
+   QRect bounds;             ///< Area covered by the grid
+   int cellSize;             ///< Width and height of a cell
+   int columns;              ///< Number of cells in a row
+   int rows;                 ///< Number of cells in a column
+   QVector<int> cellStarts;  ///< Offsets of the cells into #cellItems, plus the end
+   QVector<int> cellItems;   ///< Box indices of all cells one after another
+};
+
+#endif // BBOXGRID_H
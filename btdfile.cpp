@@ -0,0 +1,138 @@
+#include "btdfile.h"
+#include <QtCore/QDataStream>
+#include <QtCore/QIODevice>
+#include "category.h"
+#include "object.h"
+#include "objectstore.h"
+
+/// Size of the header: the magic number and the version
+static const int headerSize = 4;
+/// Size of the trailer: the position and the checksum of the directory
+static const int trailerSize = 10;
+/// Size of a directory entry of an object
+static const int objectEntrySize = 26;
+
+BTDFile::BTDFile() :
+   nextID(0)
+{
+}
+
+/** The \a data has to hold the whole file the directory was read from. The
+  * block isn't copied, nor verified or decoded before the boxes of the object
+  * get accessed, so the \a data has to stay valid until then or until
+  * Object::detachBlock() gets called.
+  * @sa ObjectStore::create(int id, QByteArray const & block, quint16 checksum, int firstFrame, int lastFrame)
+  */
+Object * BTDFile::createObject(char const * data, ObjectEntry const & entry) const {
+   return objectStore->create(entry.id, QByteArray::fromRawData(data+entry.offset, entry.size),
+                              entry.checksum, entry.firstFrame, entry.lastFrame);
+}
+
+QList<BTDFile::CategoryEntry> const & BTDFile::getCategories() const {
+   return categories;
+}
+
+quint32 BTDFile::getNextID() const {
+   return nextID;
+}
+
+QString const & BTDFile::getVideoFilename() const {
+   return videoFilename;
+}
+
+/** Besides the magic number and the version the trailer, the checksum of the
+  * directory and the positions of all blocks get verified, so the objects can
+  * be created safely afterwards. Nothing but the directory gets parsed.
+  */
+bool BTDFile::readDirectory(char const * data, qint64 size) {
+   categories.clear();
+   if (size < headerSize+trailerSize || data[0] != 'B' || data[1] != 'T' || data[2] != 'D' || data[3] != 2) {
+      return false;
+   }
+   QDataStream trailer(QByteArray::fromRawData(data+size-trailerSize, trailerSize));
+   quint64 directoryOffset;
+   quint16 directoryChecksum;
+   trailer >> directoryOffset;
+   trailer >> directoryChecksum;
+   if (directoryOffset < quint64(headerSize) || directoryOffset > quint64(size-trailerSize)) {
+      return false;
+   }
+   const QByteArray directory = QByteArray::fromRawData(data+directoryOffset, size-trailerSize-directoryOffset);
+   if (qChecksum(directory.constData(), directory.size()) != directoryChecksum) {
+      return false;
+   }
+
+   QDataStream in(directory);
+   in >> videoFilename;
+   in >> nextID;
+   quint32 categoryCount;
+   in >> categoryCount;
+   for (quint32 i=0; i<categoryCount && in.status()==QDataStream::Ok; ++i) {
+      CategoryEntry category;
+      in >> category.name;
+      quint32 objectCount;
+      in >> objectCount;
+      if (in.status() != QDataStream::Ok || objectCount > quint32(directory.size()/objectEntrySize)) {
+         return false;
+      }
+      category.objects.resize(objectCount);
+      for (quint32 j=0; j<objectCount; ++j) {
+         ObjectEntry & entry = category.objects[j];
+         in >> entry.id;
+         in >> entry.firstFrame;
+         in >> entry.lastFrame;
+         in >> entry.offset;
+         in >> entry.size;
+         in >> entry.checksum;
+         // compared without adding, so huge offsets can't wrap around
+         if (entry.offset < quint64(headerSize) || entry.offset > directoryOffset || entry.size > directoryOffset-entry.offset) {
+            return false;
+         }
+      }
+      categories << category;
+   }
+   return in.status() == QDataStream::Ok;
+}
+
+/** The file starts with the bytes 'B', 'T', 'D' and the version, followed by
+  * the blocks of all objects of all categories in order, the directory and the
+  * trailer.
+  */
+bool BTDFile::write(QIODevice & device, QString const & videoFilename, quint32 nextID, QList<Category *> const & categories) {
+   QDataStream out(&device);
+   out << (quint8)'B';
+   out << (quint8)'T';
+   out << (quint8)'D';
+   out << (quint8)2;
+
+   QByteArray directory;
+   QDataStream dir(&directory, QIODevice::WriteOnly);
+   dir << videoFilename;
+   dir << nextID;
+   dir << (quint32)categories.size();
+   quint64 offset = headerSize;
+   foreach (Category const * const category, categories) {
+      dir << category->getName();
+      dir << (quint32)category->rowCount();
+      foreach (Object const * const object, category->getObjects()) {
+         const QByteArray block = object->toBlock();
+         dir << (quint32)object->getID();
+         dir << (qint32)object->getFirstFrame();
+         dir << (qint32)object->getLastFrame();
+         dir << offset;
+         dir << (quint32)block.size();
+         dir << qChecksum(block.constData(), block.size());
+         if (device.write(block) != block.size()) {
+            return false;
+         }
+         offset += block.size();
+      }
+   }
+
+   if (device.write(directory) != directory.size()) {
+      return false;
+   }
+   out << offset;
+   out << qChecksum(directory.constData(), directory.size());
+   return out.status() == QDataStream::Ok;
+}
@@ -0,0 +1,61 @@
+#ifndef BTDFILE_H
+#define BTDFILE_H
+
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+class Category;
+class Object;
+class QIODevice;
+
+/// Directory of a BTD file in version 2.
+/** Version 2 stores the boxes of every object as a compact block (see
+  * Object::toBlock()), followed by a directory in the footer. The directory
+  * holds the categories and for each object its ID, lifespan and the position,
+  * size and checksum of its block, so single objects can be read without
+  * parsing the whole file. The last bytes of the file point to the directory.
+  * The class reads the directory and creates the objects from their blocks,
+  * which get decoded when the objects are accessed first. Writing a whole file
+  * is done by write().
+  */
+class BTDFile {
+
+public:
+   /// Directory entry of an object.
+   struct ObjectEntry {
+      quint32 id;        ///< ID of the object
+      qint32 firstFrame; ///< Framenumber of the first box
+      qint32 lastFrame;  ///< Framenumber of the last box, less than #firstFrame for empty objects
+      quint64 offset;    ///< Position of the block in the file
+      quint32 size;      ///< Size of the block in bytes
+      quint16 checksum;  ///< CRC-16 of the block
+   };
+   /// Directory entry of a category.
+   struct CategoryEntry {
+      QString name;                 ///< Name of the category
+      QVector<ObjectEntry> objects; ///< The objects of the category
+   };
+
+   /// Default c'tor, creates an empty directory.
+   BTDFile();
+   /// Reads the directory from the \a size bytes of a whole file at \a data.
+   bool readDirectory(char const * data, qint64 size);
+   /// Creates the object described by \a entry from the file at \a data without decoding its block.
+   Object * createObject(char const * data, ObjectEntry const & entry) const;
+   /// Getter for #videoFilename.
+   QString const & getVideoFilename() const;
+   /// Getter for #nextID.
+   quint32 getNextID() const;
+   /// Getter for #categories.
+   QList<CategoryEntry> const & getCategories() const;
+   /// Writes the \a categories as a whole file in version 2 to the \a device.
+   static bool write(QIODevice & device, QString const & videoFilename, quint32 nextID, QList<Category *> const & categories);
+
+private:
+   QString videoFilename;            ///< Filename of the associated video file
+   quint32 nextID;                   ///< Current ID of the id counter
+   QList<CategoryEntry> categories;  ///< The categories in the file
+};
+
+#endif // BTDFILE_H
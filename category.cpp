@@ -1,14 +1,20 @@
 #include "category.h"
+#include <QtCore/QTimer>
 #include <QtGui/QIcon>
 #include "object.h"
+#include "objectstore.h"
 
 /** Since the class derives from QAbstractListModel this ctor is called as well.
   * @sa <a href="http://qt-project.org/doc/qt-4.8/qabstractlistmodel.html#QAbstractListModel">
   *     QAbstractItemModel::QAbstractListModel(QObject * parent = 0)</a>
   */
 Category::Category(QString const & name, QObject * parent) :
-   QAbstractTableModel(parent), columncount(0), name(name)
+   QAbstractTableModel(parent), columncount(0), name(name),
+   flushTimer(new QTimer(this)), lifespansDirty(true)
 {
+   flushTimer->setSingleShot(true);
+   connect(flushTimer, SIGNAL(timeout()), this, SLOT(flushDirtyRanges()));
+   connect(objectStore, SIGNAL(dataChanged(int,int,int)), this, SLOT(objectDataChanged(int,int,int)));
 }
 
 /** Since the class derives from QAbstractListModel this ctor is called as well.
@@ -16,35 +22,63 @@ Category::Category(QString const & name, QObject * parent) :
   *     QAbstractItemModel::QAbstractListModel(QObject * parent = 0)</a>
   */
 Category::Category(QDataStream & in, QObject * parent) :
-   QAbstractTableModel(parent), columncount(0)
+   QAbstractTableModel(parent), columncount(0),
+   flushTimer(new QTimer(this)), lifespansDirty(true)
 {
+   flushTimer->setSingleShot(true);
+   connect(flushTimer, SIGNAL(timeout()), this, SLOT(flushDirtyRanges()));
+   connect(objectStore, SIGNAL(dataChanged(int,int,int)), this, SLOT(objectDataChanged(int,int,int)));
    in >> name;
    quint32 size;
    in >> size;
+   QList<Object *> newObjects;
+   newObjects.reserve(size);
    for (quint32 i=0; i<size; ++i) {
-      addObject(new Object(in));
+      newObjects << objectStore->create(in);
    }
+   addObjects(newObjects);
 }
 
 Category::~Category() {
-   qDeleteAll(objects);
+   objectStore->destroy(objects);
    objects.clear();
 }
 
 /**
  * In fact the pointer to the \a object gets added, so the submitted pointer
- * stays valid. The category takes ownership of the \a object and deletes it if
- * necessary.
+ * stays valid. The category takes ownership of the \a object and destroys it
+ * if necessary.
  */
 void Category::addObject(Object * object) {
    if (object) {
       beginInsertRows(QModelIndex(), objects.size(), objects.size());
+      rowsByID.insert(object->getID(), objects.size());
       objects << object;
+      lifespansDirty = true;
       endInsertRows();
-      connect(object, SIGNAL(dataChanged(int,int)), this, SLOT(objectDataChanged(int,int)));
    }
 }
 
+/**
+ * All objects get inserted with a single row insertion, so attached views and
+ * the lifespans get updated only once.
+ * @sa void addObject(Object * object)
+ */
+void Category::addObjects(QList<Object *> const & newObjects) {
+   QList<Object *> validObjects = newObjects;
+   validObjects.removeAll(NULL);
+   if (validObjects.isEmpty()) {
+      return;
+   }
+   beginInsertRows(QModelIndex(), objects.size(), objects.size()+validObjects.size()-1);
+   foreach (Object * object, validObjects) {
+      rowsByID.insert(object->getID(), objects.size());
+      objects << object;
+   }
+   lifespansDirty = true;
+   endInsertRows();
+}
+
 /**
  * @sa <a href="http://qt-project.org/doc/qt-4.8/qabstractitemmodel.html#columnCount">
  *     int QAbstractItemModel::columnCount(const QModelIndex & parent) const</a>
@@ -65,7 +99,7 @@ int Category::columnCount(QModelIndex const & parent) const {
 QVariant Category::data(QModelIndex const & index, int role) const {
    switch (role) {
    case Qt::DisplayRole:
-      return objects.at(index.row())->getBBox(index.column()).type;
+      return objects.at(index.row())->getType(index.column());
    case Qt::ToolTipRole:
       return QString("Frame %1").arg(index.column());
    case Qt::UserRole:
@@ -77,54 +111,48 @@ QVariant Category::data(QModelIndex const & index, int role) const {
 
 /**
  * The deletion order gets forwarded to the corresponding objects and al connected
- * views get order to update.
+ * views get order to update via objectDataChanged(), since virtual/null boxes
+ * before the deleted box could have changed, too.
  * @sa void Object::deleteBBoxAt(int framenumber)
  */
 void Category::deleteBBoxes(QModelIndexList const & selection) {
    foreach (QModelIndex const & i, selection) {
       objects.at(i.row())->deleteBBoxAt(i.column());
-      // virtual/null boxes before the deleted box could have changed, too.
-      emit dataChanged(index(i.row(), 0), i);
    }
 }
 
 /**
- * It gets the object via takeObjectAt which disconnects all signals and deletes
- * it then.
+ * It gets the object via takeObjectAt and destroys it in the ObjectStore
+ * then.
  * @note with the object all the associated bounding boxes get lost as well.
  * @sa Object * takeObjectAt(int row)
  */
 void Category::deleteObjectAt(int row) {
-   delete takeObjectAt(row);
+   objectStore->destroy(takeObjectAt(row));
 }
 
 /**
- * If the object can't be found -1 is returned.
+ * The row gets looked up in #rowsByID. If the object can't be found -1 is
+ * returned.
  */
 int Category::findObject(int id) const {
-   int row = -1;
-   int i=0;
-   while (row<0 && i<objects.size()) {
-      if (objects.at(i)->getID() == id) {
-         row = i;
-      }
-      ++i;
-   }
-   return row;
+   return rowsByID.value(id, -1);
 }
 
 /**
- * The objects simply get looped through collecting all the currently visible
- * bounding boxes which get grouped in a QList.
+ * Only the objects alive at the frame according to the #lifespanIndex get
+ * looped through collecting all the currently visible bounding boxes which get
+ * grouped in a QList in the order of the objects.
  * @note Since the returned list contains copies of the boxes altering them
  * will not affect the original data.
  * @sa BBox Object::getBBox(int framenumber) const
  */
 QList<BBox> Category::getBBoxes(int framenumber) const {
+   updateLifespans();
    QList<BBox> bboxes;
    BBox bbox;
-   foreach (Object const * const object, objects) {
-      bbox = object->getBBox(framenumber);
+   foreach (int row, lifespanIndex.rowsAt(framenumber)) {
+      bbox = objects.at(row)->getBBox(framenumber);
       if (bbox.type/* != BBox::NULLTYPE*/) {
          bboxes << bbox;
       }
@@ -132,6 +160,25 @@ QList<BBox> Category::getBBoxes(int framenumber) const {
    return bboxes;
 }
 
+/**
+ * Each object gets announced with one dataChanged signal covering all its
+ * changed frames, clamped to the columns of the model. Objects removed in the
+ * meantime are skipped.
+ */
+void Category::flushDirtyRanges() {
+   QHash<int, QPair<int, int> >::const_iterator i = dirtyRanges.constBegin();
+   while (i != dirtyRanges.constEnd()) {
+      const int row = findObject(i.key());
+      const int firstFrame = qMax(0, i.value().first);
+      const int lastFrame = qMin(columncount-1, i.value().second);
+      if (row >= 0 && firstFrame <= lastFrame) {
+         emit dataChanged(index(row, firstFrame), index(row, lastFrame));
+      }
+      ++i;
+   }
+   dirtyRanges.clear();
+}
+
 /**
  * This framecount is the actual maximum of all the objects last framenumbers and
  * therefor can be seen as a minimum width for views.
@@ -139,7 +186,7 @@ QList<BBox> Category::getBBoxes(int framenumber) const {
 int Category::getFramecount() const {
    int framecount = 0;
    foreach (Object const * const object, objects) {
-      framecount = qMax(framecount, object->lastBBox().framenumber+1);
+      framecount = qMax(framecount, object->getLastFrame()+1);
    }
    return framecount;
 }
@@ -150,17 +197,11 @@ QString const & Category::getName() const {
 
 /**
  * If no such object exists a NULL pointer is returned instead.
+ * @sa int findObject(int id) const
  */
 Object * Category::getObject(int id) {
-   Object * object = NULL;
-   int i=0;
-   while (!object && i<objects.size()) {
-      if (objects.at(i)->getID() == id) {
-         object = objects.at(i);
-      }
-      ++i;
-   }
-   return object;
+   const int row = findObject(id);
+   return row<0 ? NULL : objects.at(row);
 }
 
 QList<Object *> const & Category::getObjects() const {
@@ -209,23 +250,49 @@ bool Category::isEmpty() const {
  * a unique ID.
  */
 void Category::newObject() {
-   addObject(new Object());
+   addObject(objectStore->create());
+}
+
+/**
+ * The empty lifespan of an empty object starts after its end. The boxes of
+ * objects not accessed yet don't get decoded for this.
+ */
+LifespanIndex::Lifespan Category::lifespanOf(Object const * object) {
+   return LifespanIndex::Lifespan(object->getFirstFrame(), object->getLastFrame());
 }
 
 /**
- * It simply is a adapter to the dataChanged signal which it emits.
+ * The ObjectStore reports the changes of all objects, the ones of objects not
+ * in this category get ignored. The changed frames get merged into the
+ * #dirtyRanges, which get announced by flushDirtyRanges() once control returns
+ * to the event loop, so bulk edits and drags result in a single signal per
+ * object. The lifespans only get rebuilt if the object's lifespan changed.
  */
-void Category::objectDataChanged(int objectID, int framenumber) {
+void Category::objectDataChanged(int objectID, int firstFrame, int lastFrame) {
    const int row = findObject(objectID);
-   if (row >= 0 && framenumber >= 0) {
-      emit dataChanged(index(row, 0), index(row, framenumber));
+   if (row < 0) {
+      return;
+   }
+   if (!lifespansDirty && lifespans.at(row) != lifespanOf(objects.at(row))) {
+      lifespansDirty = true;
+   }
+   QHash<int, QPair<int, int> >::iterator range = dirtyRanges.find(objectID);
+   if (range == dirtyRanges.end()) {
+      dirtyRanges.insert(objectID, qMakePair(firstFrame, lastFrame));
+   }
+   else {
+      range.value().first = qMin(range.value().first, firstFrame);
+      range.value().second = qMax(range.value().second, lastFrame);
+   }
+   if (!flushTimer->isActive()) {
+      flushTimer->start(0);
    }
 }
 
 /**
  * In fact the pointer to the \a object gets added, so the submitted pointer
- * stays valid. The category takes ownership of the \a object and deletes it if
- * necessary.
+ * stays valid. The category takes ownership of the \a object and destroys it
+ * if necessary.
  * @sa void addObject(Object * object)
  */
 Category & Category::operator <<(Object * object) {
@@ -276,6 +343,8 @@ void Category::sortByFN() {
    beginResetModel();
    //emit layoutAboutToBeChanged();
    qStableSort(objects.begin(), objects.end(), lessThanByFN);
+   updateRows(0);
+   lifespansDirty = true;
    endResetModel();
    //emit layoutChanged();
 }
@@ -288,17 +357,47 @@ void Category::sortByID() {
    beginResetModel();
    //emit layoutAboutToBeChanged();
    qSort(objects.begin(), objects.end(), lessThanByID);
+   updateRows(0);
+   lifespansDirty = true;
    endResetModel();
    //emit layoutChanged();
 }
 
 /**
- * The connected signals get disconnected and the category ends it's ownership
+ * The category ends it's ownership, changes of the object get ignored from now
+ * on.
  */
 Object * Category::takeObjectAt(int row) {
    beginRemoveRows(QModelIndex(), row, row);
    Object * object = objects.takeAt(row);
+   rowsByID.remove(object->getID());
+   updateRows(row);
+   lifespansDirty = true;
    endRemoveRows();
-   disconnect(object, SIGNAL(dataChanged(int,int)), this, SLOT(objectDataChanged(int,int)));
    return object;
 }
+
+/**
+ * Needs to be called whenever rows got moved, e.g. after sorting or removing an
+ * object.
+ */
+void Category::updateRows(int first) {
+   for (int row=first; row<objects.size(); ++row) {
+      rowsByID[objects.at(row)->getID()] = row;
+   }
+}
+
+/**
+ * The index gets rebuilt lazily by the first query after a change.
+ */
+void Category::updateLifespans() const {
+   if (!lifespansDirty) {
+      return;
+   }
+   lifespans.resize(objects.size());
+   for (int row=0; row<objects.size(); ++row) {
+      lifespans[row] = lifespanOf(objects.at(row));
+   }
+   lifespanIndex.build(lifespans);
+   lifespansDirty = false;
+}
@@ -2,9 +2,13 @@
 #define CATEGORY_H
 
 #include <QtCore/QAbstractTableModel>
+#include <QtCore/QHash>
+#include <QtCore/QPair>
+#include "lifespanindex.h"
 #include "types.h"
 
 class Object;
+class QTimer;
 
 /// Represents a category of \ref Object "Object"s like "Person" or "Car".
 /** The class as a named list of \ref Object "Object"s is derived from
@@ -22,7 +26,7 @@ public:
    explicit Category(QString const & name, QObject * parent = 0);
    /// Reads a category from a given stream \a in
    explicit Category(QDataStream & in, QObject * parent = 0);
-   /// Deletes all objects managed by the category
+   /// Destroys all objects managed by the category
    ~Category();
    /// Returns the number of objects in the list
    int rowCount(QModelIndex const & parent  = QModelIndex()) const;
@@ -50,6 +54,8 @@ public:
    bool isEmpty() const;
    /// Adds the \a object to the internal list
    void addObject(Object * object);
+   /// Adds all the \a newObjects to the internal list at once
+   void addObjects(QList<Object *> const & newObjects);
    /// Adds the \a object to the internal list
    Category & operator<<(Object * object);
    /// Creates a new object and adds it to the internal list.
@@ -72,13 +78,28 @@ public:
    int getFramecount() const;
 
 private:
-   int columncount;         ///< The column count read from a video file
-   QString name;            ///< The name of the category.
-   QList<Object *> objects; ///< The list of objects.
+   int columncount;                          ///< The column count read from a video file
+   QString name;                             ///< The name of the category.
+   QList<Object *> objects;                  ///< The list of objects.
+   QHash<int, int> rowsByID;                 ///< The row of each of the #objects by its ID
+   QHash<int, QPair<int, int> > dirtyRanges; ///< Changed frames of the objects by their ID, not yet announced
+   QTimer * flushTimer;                      ///< Zero interval timer flushing the #dirtyRanges once per event loop iteration
+   mutable QVector<LifespanIndex::Lifespan> lifespans; ///< The lifespans of the #objects by row
+   mutable LifespanIndex lifespanIndex;                ///< Index over the #lifespans
+   mutable bool lifespansDirty;                        ///< Indicates that the #lifespans have to be rebuilt
+
+   /// Renews the #rowsByID entries of all objects from row \a first on.
+   void updateRows(int first);
+   /// Returns the lifespan of the \a object.
+   static LifespanIndex::Lifespan lifespanOf(Object const * object);
+   /// Rebuilds the #lifespans and the #lifespanIndex if they are outdated.
+   void updateLifespans() const;
 
 private slots:
-   /// Internal slot for change feedback from objects
-   void objectDataChanged(int objectID, int framenumber);
+   /// Internal slot for change feedback from the ObjectStore
+   void objectDataChanged(int objectID, int firstFrame, int lastFrame);
+   /// Emits dataChanged for all #dirtyRanges
+   void flushDirtyRanges();
 };
 
 #endif // CATEGORY_H
@@ -2,23 +2,50 @@
 #include <QtCore/QFile>
 #include <QtCore/QStack>
 #include <QtCore/QTextStream>
+#include <QtCore/QThreadPool>
+#include <QtCore/QtConcurrentMap>
+#include <QtCore/QXmlStreamReader>
+#include <QtCore/QXmlStreamWriter>
 #include <QtGui/QBoxLayout>
 #include <QtGui/QButtonGroup>
 #include <QtGui/QFileDialog>
-#include <QtGui/QHeaderView>
 #include <QtGui/QInputDialog>
 #include <QtGui/QLabel>
 #include <QtGui/QMessageBox>
 #include <QtGui/QProgressDialog>
 #include <QtGui/QPushButton>
 #include <QtGui/QSpinBox>
-#include <QtGui/QTableView>
 #include <QtGui/QToolButton>
-#include <QtXml/QDomDocument>
+#include "btdfile.h"
 #include "category.h"
+#include "filesync.h"
 #include "object.h"
-#include "bboxdelegate.h"
+#include "objectstore.h"
+#include "timelineview.h"
 #include "idcounter.h"
+#include "journal.h"
+
+/// Advances the \a reader to the first child element called \a name of the current element, returns false if there is none.
+inline bool readChildElement(QXmlStreamReader & reader, QLatin1String const & name) {
+   while (reader.readNextStartElement()) {
+      if (reader.qualifiedName() == name) {
+         return true;
+      }
+      reader.skipCurrentElement();
+   }
+   return false;
+}
+
+/// Maps the whole opened \a file into memory, returns a null array if that isn't possible.
+inline QByteArray mapFile(QFile & file) {
+   uchar * data = file.map(0, file.size());
+   return data ? QByteArray::fromRawData(reinterpret_cast<char const *>(data), file.size()) : QByteArray();
+}
+
+/// Decodes the boxes of the \a object if they are still encoded, meant to run on several threads at once.
+inline void decodeObject(Object * object) {
+   object->getBBoxes();
+}
 
 /** Also creates a default category and object for a swifter start.
   * @sa <a href="http://qt-project.org/doc/qt-4.8/qtabwidget.html#QTabWidget">
@@ -27,7 +54,8 @@
 DataWidget::DataWidget(QWidget * parent) :
    QTabWidget(parent), zoom(1), currentFrameNr(-1), selectedObjectID(-1),
    filename(QString()), videofileInfo(VideofileInfo()),
-   closeBtnGroup(new QButtonGroup(this)), editBtnGroup(new QButtonGroup(this))
+   closeBtnGroup(new QButtonGroup(this)), editBtnGroup(new QButtonGroup(this)),
+   journal(new Journal(this)), btdFile(NULL)
 {
    setContextMenuPolicy(Qt::CustomContextMenu);
 
@@ -37,35 +65,43 @@ DataWidget::DataWidget(QWidget * parent) :
    connect(editBtnGroup, SIGNAL(buttonClicked(QAbstractButton *)), this, SLOT(editCategory(QAbstractButton *)));
    connect(closeBtnGroup, SIGNAL(buttonClicked(QAbstractButton *)), this, SLOT(deleteCategory(QAbstractButton *)));
    connect(this, SIGNAL(currentChanged(int)), this, SLOT(onCurrentTabChanged(int)));
+   connect(journal, SIGNAL(compactionNeeded()), this, SLOT(saveFile()));
+   connect(objectStore, SIGNAL(objectsDamaged(QList<int>)), this, SLOT(objectsDamaged(QList<int>)));
 
    newObject();
 }
 
 DataWidget::~DataWidget() {
+   journal->close();
    qDeleteAll(categories);
    categories.clear();
+   releaseBTDContent();
 }
 
 /** The category is appended to the internal list of categories. Also a new
-  * QTableView with the category as model is created and added as a new tab.
+  * TimelineView with the category as model is created and added as a new tab.
   * @note Category derives from QAbstractListModel to make this simple
   * connection possible.
   */
 void DataWidget::addCategory(Category * cat) {
    // add category
    categories << cat;
+   journal->categoryAdded(cat->getName());
+   if (!cat->isEmpty()) {
+      journal->objectsAdded(categories.size()-1, cat->getObjects());
+   }
    cat->setColumnCount(videofileInfo.framecount);
+   connect(cat, SIGNAL(dataChanged(QModelIndex,QModelIndex)), this, SIGNAL(dataModified()));
+   connect(cat, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SIGNAL(dataModified()));
+   connect(cat, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SIGNAL(dataModified()));
+   connect(cat, SIGNAL(modelReset()), this, SIGNAL(dataModified()));
+   connect(cat, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(objectsInserted(QModelIndex,int,int)));
+   connect(cat, SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)), this, SLOT(objectsAboutToBeRemoved(QModelIndex,int,int)));
+   registerObjects(cat, 0, cat->rowCount()-1);
 
    // add tab
-   QTableView * tableView = new QTableView();
-   BBoxDelegate * delegate = new BBoxDelegate();
-   tableView->verticalHeader()->setDefaultSectionSize(20);
-   tableView->horizontalHeader()->setDefaultSectionSize(zoom);
-   tableView->horizontalHeader()->setMinimumSectionSize(1);
-   tableView->horizontalHeader()->hide();
-   tableView->setShowGrid(false);
-
-   tableView->setItemDelegate(delegate);
+   TimelineView * tableView = new TimelineView();
+   tableView->setZoom(zoom);
    tableView->setModel(cat);
    tableView->setSelectionMode(QAbstractItemView::ContiguousSelection);
    connect(tableView->selectionModel(), SIGNAL(currentChanged(QModelIndex, QModelIndex)),
@@ -114,10 +150,16 @@ Category * DataWidget::addCategory(QString const & name) {
    return cat;
 }
 
-/** If the specified category doesn't exist it gets created before inserting.
-  * @sa Category & Category::operator <<(Object * object)
+/** @sa void addObjects(QList<Object *> const & objects, QString const & catName)
   */
 void DataWidget::addObject(Object * object, QString const & catName) {
+   addObjects(QList<Object *>() << object, catName);
+}
+
+/** If the specified category doesn't exist it gets created before inserting.
+  * @sa void Category::addObjects(QList<Object *> const & newObjects)
+  */
+void DataWidget::addObjects(QList<Object *> const & objects, QString const & catName) {
    bool exists = false;
    int i = 0;
    Category * cat = NULL;
@@ -128,27 +170,26 @@ void DataWidget::addObject(Object * object, QString const & catName) {
    if (!exists) {
       cat = addCategory(catName);
    }
-   cat->addObject(object);
+   cat->addObjects(objects);
 }
 
-/** The section size of all header views gets set to the new zoomlevel and the
-  * current view gets scrolled to keep the current selection centered.
+/** All views get set to the new zoomlevel and the current view gets scrolled to
+  * keep the current selection centered.
+  * @sa void TimelineView::setZoom(int level)
   */
 void DataWidget::changeZoom(int newZoom) {
    if (zoom != newZoom) {
       zoom = newZoom;
-      QHeaderView * headerView;
       for (int i=0; i<count()-1; ++i) {
-         headerView = static_cast<QTableView *>(widget(i))->horizontalHeader();
-         headerView->setDefaultSectionSize(zoom);
-         headerView->resizeSections(QHeaderView::Interactive);
+         static_cast<TimelineView *>(widget(i))->setZoom(zoom);
       }
    }
-   QTableView * tableView = static_cast<QTableView *>(currentWidget());
+   TimelineView * tableView = static_cast<TimelineView *>(currentWidget());
    tableView->scrollTo(tableView->currentIndex(), QAbstractItemView::PositionAtCenter);
 }
 
-/** The user gets warned and asked to confirm the process.
+/** The user gets warned and asked to confirm the process. The cleared data
+  * doesn't belong to the data file anymore, so the filename gets reset.
   * @sa void clearDataImmediate()
   */
 void DataWidget::clearData() {
@@ -159,15 +200,19 @@ void DataWidget::clearData() {
    msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::Cancel);
    if (msgBox.exec() == QMessageBox::Yes) {
       clearDataImmediate();
+      filename = QString();
    }
 }
 
 /** This is called before new data is imported. Signal dataDecreased()
-  * gets emitted afterwards.
+  * gets emitted afterwards. The data doesn't belong to the data file anymore,
+  * so the journal gets closed instead of recording the deletion, which would
+  * wipe the data file on its next replay.
   * @sa void clearData()
   */
 void DataWidget::clearDataImmediate() {
    emit selectedObjectChanged(-1);
+   journal->close();
    QWidget * w;
    while (count()>1) {
       w = widget(0);
@@ -176,6 +221,8 @@ void DataWidget::clearDataImmediate() {
    }
    qDeleteAll(categories);
    categories.clear();
+   categoriesByID.clear();
+   releaseBTDContent();
    idCounter->reset();
    emit dataDecreased();
    emit categoryCountChanged(0);
@@ -207,9 +254,10 @@ void DataWidget::createCornerWidget() {
    layout->addWidget(glassLbl);
 
    QSpinBox * zoomSpin = new QSpinBox();
-   zoomSpin->setRange(1, 16);
+   zoomSpin->setRange(-12, 16);
    zoomSpin->setValue(1);
-   zoomSpin->setFixedWidth(35);
+   zoomSpin->setFixedWidth(40);
+   zoomSpin->setToolTip(tr("Pixels per frame, values below 1 halve the frame width per step"));
    connect(zoomSpin, SIGNAL(valueChanged(int)), this, SLOT(changeZoom(int)));
    layout->addWidget(zoomSpin);
 
@@ -243,7 +291,7 @@ void DataWidget::createNewCategoryTab() {
 void DataWidget::deleteBBox() {
    const int i = currentIndex();
    if (i>=0) {
-      QModelIndexList selected = static_cast<QTableView *>(widget(i))->selectionModel()->selectedIndexes();
+      QModelIndexList selected = static_cast<TimelineView *>(widget(i))->selectionModel()->selectedIndexes();
       if (!selected.isEmpty()) {
          QMessageBox msgBox;
          msgBox.setIconPixmap(QPixmap(":/icons/deletebox-32"));
@@ -274,9 +322,10 @@ void DataWidget::deleteCategory(QAbstractButton * button) {
    deleteCategory(closeBtnGroup->buttons().indexOf(button));
 }
 
-/** The user gets asked for confirmation and the corresponding signals get emitted
+/** The user gets asked for confirmation if the category isn't empty.
   * @sa void deleteCategory()
   * @sa void deleteCategory(QAbstractButton * button)
+  * @sa void deleteCategoryImmediate(int index)
   */
 void DataWidget::deleteCategory(int index) {
    if (index>=0) {
@@ -286,21 +335,30 @@ void DataWidget::deleteCategory(int index) {
       msgBox.setInformativeText("All contained objects will be lost, too.");
       msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::Cancel);
       if (categories.at(index)->isEmpty() || msgBox.exec() == QMessageBox::Yes) {
-         if (index==currentIndex() && index==count()-2) {
-            // if the last valid tab was selected the "add new cat." tab would be selected afterwards
-            setCurrentIndex(index-1);
-         }
-         emit selectedObjectChanged(-1);
-         QWidget * tableView = widget(index);
-         removeTab(index);
-         delete tableView;
-         delete categories.takeAt(index);
-         emit dataDecreased();
-         emit categoryCountChanged(count()-1);
+         deleteCategoryImmediate(index);
       }
    }
 }
 
+/** The category gets deleted along with its tab and the corresponding signals
+  * get emitted.
+  */
+void DataWidget::deleteCategoryImmediate(int index) {
+   if (index==currentIndex() && index==count()-2) {
+      // if the last valid tab was selected the "add new cat." tab would be selected afterwards
+      setCurrentIndex(index-1);
+   }
+   emit selectedObjectChanged(-1);
+   journal->categoryDeleted(index);
+   QWidget * tableView = widget(index);
+   removeTab(index);
+   delete tableView;
+   unregisterObjects(categories.at(index), 0, categories.at(index)->rowCount()-1);
+   delete categories.takeAt(index);
+   emit dataDecreased();
+   emit categoryCountChanged(count()-1);
+}
+
 /** Actually the selection gets converted to a rownumber and the corresponding
   * function from the currently shown category is called.
   * @sa void Category::deleteObjectAt(int row)
@@ -373,6 +431,7 @@ void DataWidget::editCategory(int index) {
    if (ok && !name.isEmpty()) {
       categories.at(index)->setName(name);
       setTabText(index, name);
+      journal->categoryRenamed(index, name);
    }
 }
 
@@ -402,16 +461,20 @@ void DataWidget::editObject() {
             objects.push(category->takeObjectAt(row));
          }
          // add objects to new category (reverse reverse order)
+         QList<Object *> movedObjects;
          while (!objects.isEmpty()) {
-            addObject(objects.pop(), item);
+            movedObjects << objects.pop();
          }
+         addObjects(movedObjects, item);
          emit dataDecreased();
       }
    }
 }
 
 /** Asks the user for a filename and type, creates a file and calls the
-  * appropriate export function.
+  * appropriate export function. The data gets exported to a temporary file
+  * first, which replaces the chosen file only once the export is complete, so
+  * an aborted export leaves an existing file untouched.
   * @sa void exportBBFile(QFile & file)
   * @sa void exportViperFile(QFile & file)
   */
@@ -453,26 +516,40 @@ void DataWidget::exportFile() {
       }
    }
    // Save file.
-   QFile file(filename);
+   const QString tempFilename = filename+".tmp";
+   QFile file(tempFilename);
    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
       QMessageBox::warning(this, tr("Unable to open file"), tr("Unable to create/open file\n\"")
-                                                            +filename.section('/', -1)
+                                                            +tempFilename.section('/', -1)
                                                             +tr("\"\nfor writing!"));
       return;
    }
    // Determine filetype according to the selected filter.
+   bool exported = false;
    if (selectedFilter == xmlFilter) {
-      exportViperFile(file);
+      exported = exportViperFile(file);
    }
    else if (selectedFilter == bbFilter) {
       exportBBFile(file);
+      exported = true;
    }
    else {
       QMessageBox::warning(this, tr("Unknown file type"), tr("The requested type of the file\n\"")
                                                           +filename.section('/', -1)
                                                           +tr("\"\nsomehow couldn't be determined!"));
    }
+   exported = file.flush() && exported;
    file.close();
+   if (!exported) {
+      file.remove();
+   }
+   else if (!replaceFile(tempFilename, filename)) {
+      QMessageBox::warning(this, tr("Unable to access file"), tr("The data got exported to\n\"")
+                                                              +tempFilename.section('/', -1)
+                                                              +tr("\"\nbut couldn't replace\n\"")
+                                                              +filename.section('/', -1)
+                                                              +tr("\"!"));
+   }
 }
 
 /**
@@ -495,24 +572,28 @@ void DataWidget::exportBBFile(QFile & file) {
    foreach(Category const * const category, categories) {
       foreach (Object const * const object, category->getObjects()) {
           if (!(object->isEmpty())){
-             currentObj = new Object();
-             currentFrame = object->getBBoxes().begin().value().framenumber; // point to first bbox in qmap - has to be the one with the lowest key, a.k.a. framenumber
+             currentObj = objectStore->create();
+             currentFrame = object->firstBBox().framenumber; // the boxes are sorted, so the first one has the lowest framenumber
              frameList.insert(currentFrame, currentObj);
              // add BBoxes, if non-consecutive, split objects
-             foreach (BBox const currentBBox, object->getBBoxes()) {
+             QVector<PackedBBox> const & packedBBoxes = object->getBBoxes();
+             for (int j=0; j<packedBBoxes.size(); ++j) {
+                const BBox currentBBox = packedBBoxes.at(j).unpack(object->getID());
                 // generate Bboxes from virtual frames and add them
                 if ((currentBBox.framenumber != currentFrame ) && (currentBBox.type == BBox::KEYBOX)){
-                   BBox lastBBox = (object->getBBoxes().lowerBound(currentBBox.framenumber)-1).value();
+                   BBox lastBBox = packedBBoxes.at(j-1).unpack(object->getID());
                    currentObj->addBBox(lastBBox);
-                   for (int i=lastBBox.framenumber+1; i<currentBBox.framenumber; i++){
-                     currentObj->addBBox( interpolate(i,lastBBox,currentBBox) );
+                   QVector<QRect> rects(currentBBox.framenumber-lastBBox.framenumber-1);
+                   interpolateSegment(lastBBox, currentBBox, rects.data());
+                   for (int i=0; i<rects.size(); i++){
+                     currentObj->addBBox(BBox(lastBBox.framenumber+1+i, rects.at(i), lastBBox.objectID, BBox::VIRTUAL));
                    }
                    currentObj->addBBox(currentBBox);
                    currentFrame=currentBBox.framenumber;
                 // or split into new objects
                 }else if (currentBBox.framenumber != currentFrame ){
                    currentFrame = currentBBox.framenumber;
-                   currentObj = new Object();
+                   currentObj = objectStore->create();
                    currentObj->addBBox(currentBBox);
                    frameList.insert(currentFrame, currentObj);
                 // or just add
@@ -542,7 +623,7 @@ void DataWidget::exportBBFile(QFile & file) {
          out << (i.peekPrevious()->getBBoxes()).size() << endl;
          //fuer jedes objekt alle bboxen:
          // ohne erst in int parsen zu müssen wär's schneller?
-         foreach (BBox const currentBox, i.previous()->getBBoxes()){
+         foreach (PackedBBox const currentBox, i.previous()->getBBoxes()){
             out << double(currentBox.rect.left()) <<";";
             out << double(currentBox.rect.top())  <<";";
             out << double(currentBox.rect.width())<<";";
@@ -550,16 +631,23 @@ void DataWidget::exportBBFile(QFile & file) {
          }
       }
    }
+   objectStore->destroy(frameList.values());
 }
 
-/** @note Since the ViPER file format doesnt support interpolated boxes they
+/** The elements get written to the file while they are created, so no
+  * document is held in memory. All nodes are written by the GUI thread in the
+  * order of the categories and objects, while the objects of the next chunk get
+  * decoded in parallel. The GUI thread waits for them before handling events,
+  * so nothing else accesses objects while they are decoded. Returns false if
+  * the export got aborted.
+  * @note Since the ViPER file format doesnt support interpolated boxes they
   *       will be transformed to single boxes.
   * @note The official definition of the ViPER file format can be viewed here:
   * <a href="http://viper-toolkit.sourceforge.net/docs/file/">ViPER XML</a>
   * @sa void exportFile()
   * @sa void exportBBFile(QFile & file)
   */
-void DataWidget::exportViperFile(QFile & file) {
+bool DataWidget::exportViperFile(QFile & file) {
    int progressMax = 1;
    foreach(Category const * const category, categories) {
       progressMax += category->rowCount();
@@ -569,103 +657,111 @@ void DataWidget::exportViperFile(QFile & file) {
    progress.show();
    progress.setValue(0);
 
-   QDomDocument doc;
-   QDomProcessingInstruction header = doc.createProcessingInstruction("xml", "version=\"1.0\" encoding=\"UTF-8\"");
-   doc.appendChild(header);
-
-   QDomElement rootDE = doc.createElement("viper");
-   rootDE.setAttribute("xmlns", "http://lamp.cfar.umd.edu/viper");
-   rootDE.setAttribute("xmlns:data", "http://lamp.cfar.umd.edu/viperdata");
-   doc.appendChild(rootDE);
-
-   QDomElement configDE = doc.createElement("config");
-   rootDE.appendChild(configDE);
-
-   QDomElement descriptorDE = doc.createElement("descriptor");
-   descriptorDE.setAttribute("name", "Information");
-   descriptorDE.setAttribute("type", "FILE");
-   configDE.appendChild(descriptorDE);
-
-   QDomElement attributeDE = doc.createElement("attribute");
-   attributeDE.setAttribute("dynamic", "false");
-   attributeDE.setAttribute("name", "NUMFRAMES");
-   attributeDE.setAttribute("type", "dvalue");
-   descriptorDE.appendChild(attributeDE);
-
-   attributeDE = doc.createElement("attribute");
-   attributeDE.setAttribute("dynamic", "false");
-   attributeDE.setAttribute("name", "H-FRAME-SIZE");
-   attributeDE.setAttribute("type", "dvalue");
-   descriptorDE.appendChild(attributeDE);
-
-   attributeDE = doc.createElement("attribute");
-   attributeDE.setAttribute("dynamic", "false");
-   attributeDE.setAttribute("name", "V-FRAME-SIZE");
-   attributeDE.setAttribute("type", "dvalue");
-   descriptorDE.appendChild(attributeDE);
+   QXmlStreamWriter writer(&file);
+   writer.setAutoFormatting(true);
+   writer.setAutoFormattingIndent(4);
+   writer.writeStartDocument();
+
+   writer.writeStartElement("viper");
+   writer.writeAttribute("xmlns", "http://lamp.cfar.umd.edu/viper");
+   writer.writeAttribute("xmlns:data", "http://lamp.cfar.umd.edu/viperdata");
+
+   writer.writeStartElement("config");
+
+   writer.writeStartElement("descriptor");
+   writer.writeAttribute("name", "Information");
+   writer.writeAttribute("type", "FILE");
+
+   writer.writeEmptyElement("attribute");
+   writer.writeAttribute("dynamic", "false");
+   writer.writeAttribute("name", "NUMFRAMES");
+   writer.writeAttribute("type", "dvalue");
+
+   writer.writeEmptyElement("attribute");
+   writer.writeAttribute("dynamic", "false");
+   writer.writeAttribute("name", "H-FRAME-SIZE");
+   writer.writeAttribute("type", "dvalue");
+
+   writer.writeEmptyElement("attribute");
+   writer.writeAttribute("dynamic", "false");
+   writer.writeAttribute("name", "V-FRAME-SIZE");
+   writer.writeAttribute("type", "dvalue");
+
+   writer.writeEndElement(); // descriptor
 
    foreach(Category const * const category, categories) {
-      descriptorDE = doc.createElement("descriptor");
-      descriptorDE.setAttribute("name", category->getName());
-      descriptorDE.setAttribute("type", "OBJECT");
-      configDE.appendChild(descriptorDE);
+      writer.writeStartElement("descriptor");
+      writer.writeAttribute("name", category->getName());
+      writer.writeAttribute("type", "OBJECT");
+
+      writer.writeEmptyElement("attribute");
+      writer.writeAttribute("dynamic", "true");
+      writer.writeAttribute("name", "BoundingBox");
+      writer.writeAttribute("type", "bbox");
 
-      attributeDE = doc.createElement("attribute");
-      attributeDE.setAttribute("dynamic", "true");
-      attributeDE.setAttribute("name", "BoundingBox");
-      attributeDE.setAttribute("type", "bbox");
-      descriptorDE.appendChild(attributeDE);
+      writer.writeEndElement(); // descriptor
    }
 
-   // write the data section
-   QDomElement dataDE = doc.createElement("data");
-   rootDE.appendChild(dataDE);
-
-   QDomElement sourcefileDE = doc.createElement("sourcefile");
-   sourcefileDE.setAttribute("filename", videofileInfo.filename);
-   dataDE.appendChild(sourcefileDE);
-
-   QDomElement fileDE = doc.createElement("file");
-   fileDE.setAttribute("id", 0);
-   fileDE.setAttribute("name", "Information");
-   sourcefileDE.appendChild(fileDE);
-
-   attributeDE = doc.createElement("attribute");
-   attributeDE.setAttribute("name", "NUMFRAMES");
-   fileDE.appendChild(attributeDE);
-   QDomElement datavalueDE = doc.createElement("data:dvalue");
-   datavalueDE.setAttribute("value", videofileInfo.framecount);
-   attributeDE.appendChild(datavalueDE);
-
-   attributeDE = doc.createElement("attribute");
-   attributeDE.setAttribute("name", "H-FRAME-SIZE");
-   fileDE.appendChild(attributeDE);
-   datavalueDE = doc.createElement("data:dvalue");
-   datavalueDE.setAttribute("value", videofileInfo.size.width());
-   attributeDE.appendChild(datavalueDE);
-
-   attributeDE = doc.createElement("attribute");
-   attributeDE.setAttribute("name", "V-FRAME-SIZE");
-   fileDE.appendChild(attributeDE);
-   datavalueDE = doc.createElement("data:dvalue");
-   datavalueDE.setAttribute("value", videofileInfo.size.height());
-   attributeDE.appendChild(datavalueDE);
+   writer.writeEndElement(); // config
 
+   // write the data section
+   writer.writeStartElement("data");
+
+   writer.writeStartElement("sourcefile");
+   writer.writeAttribute("filename", videofileInfo.filename);
+
+   writer.writeStartElement("file");
+   writer.writeAttribute("id", "0");
+   writer.writeAttribute("name", "Information");
+
+   writer.writeStartElement("attribute");
+   writer.writeAttribute("name", "NUMFRAMES");
+   writer.writeEmptyElement("data:dvalue");
+   writer.writeAttribute("value", QString::number(videofileInfo.framecount));
+   writer.writeEndElement(); // attribute
+
+   writer.writeStartElement("attribute");
+   writer.writeAttribute("name", "H-FRAME-SIZE");
+   writer.writeEmptyElement("data:dvalue");
+   writer.writeAttribute("value", QString::number(videofileInfo.size.width()));
+   writer.writeEndElement(); // attribute
+
+   writer.writeStartElement("attribute");
+   writer.writeAttribute("name", "V-FRAME-SIZE");
+   writer.writeEmptyElement("data:dvalue");
+   writer.writeAttribute("value", QString::number(videofileInfo.size.height()));
+   writer.writeEndElement(); // attribute
+
+   writer.writeEndElement(); // file
+
+   // the objects get decoded in chunks on all threads, one chunk ahead of the
+   // one being written
+   const int chunkSize = 16*QThreadPool::globalInstance()->maxThreadCount();
    int counter = 1;
 
    foreach(Category const * const category, categories) {
-      foreach (Object const * const object, category->getObjects()) {
-         sourcefileDE.appendChild(object->toViperNode(doc, category->getName()));
-         progress.setValue(counter++);
+      QList<Object *> const & objects = category->getObjects();
+      QList<Object *> chunk = objects.mid(0, chunkSize);
+      QtConcurrent::blockingMap(chunk, decodeObject);
+      for (int first=0; first<objects.size(); first+=chunkSize) {
+         const QList<Object *> decoded = chunk;
+         chunk = objects.mid(first+chunkSize, chunkSize);
+         QFuture<void> decoding = QtConcurrent::map(chunk, decodeObject);
+         foreach (Object const * const object, decoded) {
+            object->writeViperNode(writer, category->getName());
+         }
+         decoding.waitForFinished();
+         counter += decoded.size();
+         progress.setValue(counter);
          if (progress.wasCanceled()) {
-            return;
+            return false;
          }
       }
    }
 
-   QTextStream out(&file);
-   out << doc.toString(4);
+   writer.writeEndDocument();
    progress.setValue(progressMax);
+   return true;
 }
 
 /** Internally all categories get asked for their matching bounding boxes, which
@@ -688,18 +784,20 @@ QList<BBox> DataWidget::getBBoxes(int framenumber) const {
   */
 BBox::Type DataWidget::getCurrentBBoxType() const {
    Cell cell = getSelection();
-   return categories.at(cell.index)->getObjects().at(cell.row)->getBBox(cell.column).type;
+   return categories.at(cell.index)->getObjects().at(cell.row)->getType(cell.column);
+}
+
+/** It is empty as long as the data wasn't saved or loaded.
+  */
+QString DataWidget::getFilename() const {
+   return filename;
 }
 
 /** If no such object exists a NULL pointer is returned instead.
   */
 Object * DataWidget::getObject(int id) const {
-   Object * object = NULL;
-   int i=0;
-   while (!object && i<categories.size()) {
-      object = categories.at(i++)->getObject(id);
-   }
-   return object;
+   Category * const category = categoriesByID.value(id, NULL);
+   return category ? category->getObject(id) : NULL;
 }
 
 /** @note The list of rownumbers doesn't contain duplicates and is sorted in descending order
@@ -707,7 +805,7 @@ Object * DataWidget::getObject(int id) const {
 QList<int> DataWidget::getSelectedRows() const {
    QList<int> rows;
    if (currentIndex() >= 0) {
-      const QModelIndexList selected = static_cast<QTableView *>(currentWidget())->selectionModel()->selectedIndexes();
+      const QModelIndexList selected = static_cast<TimelineView *>(currentWidget())->selectionModel()->selectedIndexes();
       if (!selected.isEmpty()) {
          // extract the row numbers, omit duplicates
          foreach (QModelIndex const & index, selected) {
@@ -726,7 +824,7 @@ QList<int> DataWidget::getSelectedRows() const {
   * column.
   */
 DataWidget::Cell DataWidget::getSelection() const {
-   return Cell(currentIndex(), static_cast<QTableView *>(currentWidget())->currentIndex());
+   return Cell(currentIndex(), static_cast<TimelineView *>(currentWidget())->currentIndex());
 }
 
 /** The corresponding filename gets asked from the user via a QFileDialog and
@@ -760,6 +858,9 @@ void DataWidget::importFile() {
       return;
    }
 
+   // the imported data doesn't belong to the current data file
+   journal->close();
+
    if (selectedFilter == xmlFilter || openFilename.section('.', -1).toLower() == "xml") {
       // viper file
       importViperFile(file);
@@ -814,6 +915,9 @@ void DataWidget::importBBFile(QFile & file) {
    Category * BBcat;
    QRect BBrect;
    BBox box;
+   QList<BBox> BBboxes;
+   // the objects get attached at once when the whole file is read
+   QList<Object *> BBobjects;
    BBcat = addCategory (QString("Objects"));
    // variables for reading the file:
    QTextStream data (&file);
@@ -831,6 +935,7 @@ void DataWidget::importBBFile(QFile & file) {
 
       progress.setValue(i);
       if (progress.wasCanceled()) {
+         objectStore->destroy(BBobjects);
          clearDataImmediate();
          return;
       }
@@ -847,6 +952,7 @@ void DataWidget::importBBFile(QFile & file) {
                                                                  +tr(" in Line ")
                                                                  +QString("%1").arg(lineNo)
                                                                 );
+         BBcat->addObjects(BBobjects);
          return;
       }
       // read object number for this frame
@@ -854,7 +960,9 @@ void DataWidget::importBBFile(QFile & file) {
       lineNo++;
       // loop over all objects and  for each
       for (int objNo =0; objNo < objCount; objNo++){
-        BBobject = new Object();
+        BBobject = objectStore->create();
+        BBobjects << BBobject;
+        BBboxes.clear();
         // read lifetime number in frames
         //std::cout <<"printing object number: " << objNo << std::endl;
         bboxCount = int(data.readLine().toInt());
@@ -876,23 +984,29 @@ void DataWidget::importBBFile(QFile & file) {
                                                                      +tr("\" in line ")
                                                                      +QString("%1").arg(lineNo)
                                                                      +tr(":\n Error parsing BBox data"));
+                 BBobject->addBBoxes(BBboxes);
+                 BBcat->addObjects(BBobjects);
                  return;
             }
             // add bbox with category
             //construct BBox:
             box = BBox(i+currentBbox, BBrect, BBobject->getID(), BBox::SINGLE);
             // add to list first, because bb file stores them with ascending filenumbers!, instead of adding directly
-            BBobject->addBBox(box);
+            BBboxes << box;
 
          }
-         BBcat->addObject(BBobject);
+         BBobject->addBBoxes(BBboxes);
       }
    }
+   BBcat->addObjects(BBobjects);
    progress.setValue(dataFrameCount);
 }
 
-/** If the reading or parsing fails at any stage before tracking data could be
-  * read the function simply aborts.
+/** The file gets parsed as a stream, so the objects get created while their
+  * nodes are read and the progress follows the bytes read. The current data
+  * only gets replaced once the whole file got read and turned out to be valid,
+  * so if the reading or parsing fails at any stage or the import gets aborted
+  * the function simply discards the objects read so far.
   * @note Since the ViPER format has far more potential than we need some
   * informations simply get omitted. This inflicts the whole config node, all
   * but one sourcefile nodes, file and content nodes, others than the first
@@ -908,72 +1022,95 @@ void DataWidget::importViperFile(QFile & file) {
    progress.setWindowModality(Qt::WindowModal);
    progress.show();
    progress.setValue(0);
+   const qint64 fileSize = qMax<qint64>(file.size(), 1);
 
-   QDomDocument doc(tr("ViPER file"));
-   // load file in QDomDocument
-   if (!doc.setContent(&file)) {
-      file.close();
+   // like with the DOM parser used before, namespaces don't get resolved
+   QXmlStreamReader reader(&file);
+   reader.setNamespaceProcessing(false);
+   if (!reader.readNextStartElement()) {
       QMessageBox::warning(this, tr("Invalid XML file"), tr("The file\n\"")
                                                          +file.fileName().section('/', -1)
                                                          +tr("\"\nis not a valid XML file!"));
       return;
    }
 
-   QDomElement viperElem = doc.documentElement();
-   if (viperElem.tagName() != QString("viper")) {
+   if (reader.qualifiedName() != QLatin1String("viper")) {
       QMessageBox::warning(this, tr("Not a ViPER file"), tr("The file\n\"")
                                                          +file.fileName().section('/', -1)
                                                          +tr("\"\nis not a ViPER file!"));
       return;
    }
 
-   QDomElement dataElem = viperElem.firstChildElement(QString("data"));
-   if (dataElem.isNull()) {
-      QMessageBox::warning(this, tr("Not a valid ViPER file"), tr("The file\n\"")
-                                                               +file.fileName().section('/', -1)
-                                                               +tr("\"\nis not a valid ViPER file!"));
-      return;
-   }
-
-   QDomElement sourcefileElem = dataElem.firstChildElement(QString("sourcefile"));
-   if (sourcefileElem.isNull()) {
-      QMessageBox::warning(this, tr("Not a valid ViPER file"), tr("The file\n\"")
-                                                               +file.fileName().section('/', -1)
-                                                               +tr("\"\nis not a valid ViPER file!"));
+   if (!readChildElement(reader, QLatin1String("data")) || !readChildElement(reader, QLatin1String("sourcefile"))) {
+      if (reader.hasError()) {
+         QMessageBox::warning(this, tr("Invalid XML file"), tr("The file\n\"")
+                                                            +file.fileName().section('/', -1)
+                                                            +tr("\"\nis not a valid XML file!"));
+      }
+      else {
+         QMessageBox::warning(this, tr("Not a valid ViPER file"), tr("The file\n\"")
+                                                                  +file.fileName().section('/', -1)
+                                                                  +tr("\"\nis not a valid ViPER file!"));
+      }
       return;
    }
 
-   videofileInfo.filename = sourcefileElem.attribute(QString("filename"));
-
-   int progressMax = sourcefileElem.childNodes().size();
-   progress.setMaximum(progressMax);
-   int counter = 1;
-
-   // clear the current data
-   clearDataImmediate();
+   const QString videoFilename = reader.attributes().value(QLatin1String("filename")).toString();
 
-   QDomElement objectElem = sourcefileElem.firstChildElement(QString("object"));
    Object * object;
-   while (!objectElem.isNull()) {
-      object = new Object(objectElem);
+   int maxID = -1;
+   // the objects get collected per category off the model, so the current data
+   // stays untouched until the whole file turned out to be valid
+   QStringList catNames;
+   QHash<QString, QList<Object *> > catObjects;
+   while (readChildElement(reader, QLatin1String("object"))) {
+      const QString catName = reader.attributes().value(QLatin1String("name")).toString();
+      object = objectStore->create(reader);
 
       if (object->isEmpty()) {
-         delete object;
+         objectStore->destroy(object);
          object = NULL;
       }
       else {
-         addObject(object, objectElem.attribute(QString("name")));
+         if (!catObjects.contains(catName)) {
+            catNames << catName;
+         }
+         catObjects[catName] << object;
+         maxID = qMax(maxID, object->getID());
       }
 
-      progress.setValue(counter++);
+      progress.setValue(int(file.pos()*100/fileSize));
       if (progress.wasCanceled()) {
-         clearDataImmediate();
+         foreach (QList<Object *> const & objects, catObjects) {
+            objectStore->destroy(objects);
+         }
          return;
       }
+   }
 
-      objectElem = objectElem.nextSiblingElement(QString("object"));
+   // the rest of the file has to be well-formed as well
+   while (!reader.atEnd()) {
+      reader.readNext();
+   }
+   if (reader.hasError()) {
+      foreach (QList<Object *> const & objects, catObjects) {
+         objectStore->destroy(objects);
+      }
+      QMessageBox::warning(this, tr("Invalid XML file"), tr("The file\n\"")
+                                                         +file.fileName().section('/', -1)
+                                                         +tr("\"\nis not a valid XML file!"));
+      return;
    }
-   progress.setValue(progressMax);
+
+   // replace the current data, the IDs of the imported objects got taken
+   // from the counter before it got reset, so it continues after them
+   clearDataImmediate();
+   videofileInfo.filename = videoFilename;
+   foreach (QString const & catName, catNames) {
+      addObjects(catObjects.value(catName), catName);
+   }
+   idCounter->reset(maxID+1);
+   progress.setValue(100);
 
    // request the corresponding video file
    if (!videofileInfo.filename.isEmpty()) {
@@ -1014,7 +1151,7 @@ void DataWidget::newCategory() {
       }
       else {
          Category * cat = addCategory(name);
-         cat->addObject(new Object());
+         cat->addObject(objectStore->create());
       }
       // show the category
       setSelection(i, 0, currentFrameNr);
@@ -1030,11 +1167,50 @@ void DataWidget::newObject() {
       categories.at(currentIndex())->newObject();
    }
    else {
-      addObject(new Object, tr("Default"));
+      addObject(objectStore->create(), tr("Default"));
    }
    setSelection(currentIndex(), categories.at(currentIndex())->getObjects().size()-1, currentFrameNr);
 }
 
+/** The objects get unregistered before the category removes them.
+  * @sa void unregisterObjects(Category * category, int first, int last)
+  */
+void DataWidget::objectsAboutToBeRemoved(QModelIndex const &, int first, int last) {
+   Category * const category = qobject_cast<Category *>(sender());
+   if (journal->isOpen() && category) {
+      QList<int> ids;
+      for (int row=first; row<=last; ++row) {
+         ids << category->getObjects().at(row)->getID();
+      }
+      journal->objectsDeleted(ids);
+   }
+   unregisterObjects(category, first, last);
+}
+
+/** Objects of a file in version 2 get decoded on their first access, so damaged
+  * ones are only found then. They are empty afterwards and get saved that way.
+  */
+void DataWidget::objectsDamaged(QList<int> const & objectIDs) {
+   QStringList ids;
+   foreach (int id, objectIDs) {
+      ids << QString::number(id);
+   }
+   QMessageBox::warning(this, tr("Damaged objects"), tr("The bounding boxes of %1 damaged objects of the file\n\"%2\"\ncouldn't be read, the objects are empty now:\n%3")
+                                                     .arg(objectIDs.size())
+                                                     .arg(filename.section('/', -1))
+                                                     .arg(ids.join(", ")));
+}
+
+/** @sa void registerObjects(Category * category, int first, int last)
+  */
+void DataWidget::objectsInserted(QModelIndex const &, int first, int last) {
+   Category * const category = qobject_cast<Category *>(sender());
+   registerObjects(category, first, last);
+   if (journal->isOpen() && category) {
+      journal->objectsAdded(categories.indexOf(category), category->getObjects().mid(first, last-first+1));
+   }
+}
+
 /** This is used to catch the case that the last tab gets focus. In this case
   * the focus is set to the first index and a new category is created. ("new tab"
   * tab behavior)
@@ -1047,7 +1223,7 @@ void DataWidget::onCurrentTabChanged(int index) {
          newCategory();
       }
       else {
-         static_cast<QTableView *>(currentWidget())->selectionModel()->clear();
+         static_cast<TimelineView *>(currentWidget())->selectionModel()->clear();
          setSelection(currentIndex(), 0, currentFrameNr);
       }
    }
@@ -1055,6 +1231,10 @@ void DataWidget::onCurrentTabChanged(int index) {
 
 /** If anything bad happens before any data can be read the function aborts with
   * a warning, else the old data is cleared an the new is read from th file.
+  * Files in version 1 and 2 of the BTD format can be read. Files in version 2
+  * stay mapped into memory, only their directory gets read up front while the
+  * boxes of each object get decoded when they are accessed first. Damaged
+  * objects are detected at that point and left empty.
   * @note The filename is saved in \ref filename for saveFile()
   */
 void DataWidget::openFile() {
@@ -1101,29 +1281,78 @@ void DataWidget::openFile() {
       return;
    }
    in >> tempByte;
-   if (tempByte != (quint8)1) {
+   const quint8 version = tempByte;
+   if (version != (quint8)1 && version != (quint8)2) {
       QMessageBox::warning(this, tr("Wrong version"), tr("The file\n\"")
                                                       +openFilename.section('/', -1)
                                                       +tr("\"\nhas a not supported version!"));
       return;
    }
+   // version 2 gets mapped into memory if possible and only the directory is read,
+   // the objects get decoded when they are accessed
+   QFile * mappedFile = NULL;
+   QByteArray content;
+   BTDFile btd;
+   if (version == (quint8)2) {
+      mappedFile = new QFile(openFilename);
+      if (mappedFile->open(QIODevice::ReadOnly)) {
+         content = mapFile(*mappedFile);
+      }
+      if (content.isNull()) {
+         delete mappedFile;
+         mappedFile = NULL;
+         file.seek(0);
+         content = file.readAll();
+      }
+      if (!btd.readDirectory(content.constData(), content.size())) {
+         delete mappedFile;
+         QMessageBox::warning(this, tr("Invalid file"), tr("The file\n\"")
+                                                        +openFilename.section('/', -1)
+                                                        +tr("\"\nis damaged!"));
+         return;
+      }
+   }
 
-   // point of no return
+   // point of no return, the changes to the old file are already journaled
+   journal->close();
    clearDataImmediate();
+   btdFile = mappedFile;
+   btdContent = content;
 
    filename = openFilename;
 
-   in >> videofileInfo.filename;
+   if (version == (quint8)1) {
+      in >> videofileInfo.filename;
 
-   quint32 id;
-   in >> id;
-   idCounter->reset(id);
+      quint32 id;
+      in >> id;
+      idCounter->reset(id);
 
-   quint32 size;
-   in >> size;
-   for (quint32 i=0; i<size; ++i) {
-      addCategory(new Category(in));
+      quint32 size;
+      in >> size;
+      for (quint32 i=0; i<size; ++i) {
+         addCategory(new Category(in));
+      }
    }
+   else {
+      videofileInfo.filename = btd.getVideoFilename();
+      idCounter->reset(btd.getNextID());
+      foreach (BTDFile::CategoryEntry const & entry, btd.getCategories()) {
+         Category * category = new Category(entry.name);
+         QList<Object *> objects;
+         objects.reserve(entry.objects.size());
+         foreach (BTDFile::ObjectEntry const & objectEntry, entry.objects) {
+            objects << btd.createObject(btdContent.constData(), objectEntry);
+         }
+         category->addObjects(objects);
+         addCategory(category);
+      }
+   }
+   file.close();
+
+   // recover the changes made since the last save and continue the journal
+   replayJournal();
+   journal->open(filename);
 
    // request the corresponding video file
    if (!videofileInfo.filename.isEmpty()) {
@@ -1133,8 +1362,206 @@ void DataWidget::openFile() {
    updateFramecount();
 }
 
-/** The filename is taken from \ref filename. If this is empty saveFileAs() is called
+/** Keeps #categoriesByID up to date so objects can be found without searching
+  * all categories.
+  */
+void DataWidget::registerObjects(Category * category, int first, int last) {
+   if (category) {
+      for (int row=first; row<=last; ++row) {
+         categoriesByID.insert(category->getObjects().at(row)->getID(), category);
+      }
+   }
+}
+
+/** Objects read from a file in version 2 refer to its content until their boxes
+  * get decoded. The saved file holds the same blocks in the same order, so it
+  * gets mapped and those objects get pointed to it, which releases the old file
+  * without copying any blocks. Returns false if the saved file couldn't be
+  * mapped or doesn't match the data.
+  * @sa void Object::rebaseBlock(char const * data)
+  */
+bool DataWidget::rebaseBTDContent(QString const & savedFilename) {
+   if (btdContent.isNull()) {
+      return true;
+   }
+   QFile * savedFile = new QFile(savedFilename);
+   QByteArray content;
+   if (savedFile->open(QIODevice::ReadOnly)) {
+      content = mapFile(*savedFile);
+   }
+   BTDFile btd;
+   bool matching = !content.isNull() && btd.readDirectory(content.constData(), content.size())
+                   && btd.getCategories().size() == categories.size();
+   for (int i=0; matching && i<categories.size(); ++i) {
+      matching = btd.getCategories().at(i).objects.size() == categories.at(i)->rowCount();
+   }
+   if (!matching) {
+      delete savedFile;
+      return false;
+   }
+
+   for (int i=0; i<categories.size(); ++i) {
+      QVector<BTDFile::ObjectEntry> const & entries = btd.getCategories().at(i).objects;
+      QList<Object *> const & objects = categories.at(i)->getObjects();
+      for (int j=0; j<objects.size(); ++j) {
+         objects.at(j)->rebaseBlock(content.constData()+entries.at(j).offset);
+      }
+   }
+   btdContent = content;
+   delete btdFile;
+   btdFile = savedFile;
+   return true;
+}
+
+/** Objects read from a file in version 2 refer to its content until their
+  * boxes get decoded, so those still encoded get copied before the content and
+  * the mapping of the file are released.
+  * @sa void Object::detachBlock()
+  */
+void DataWidget::releaseBTDContent() {
+   foreach (Category * category, categories) {
+      foreach (Object * object, category->getObjects()) {
+         object->detachBlock();
+      }
+   }
+   btdContent.clear();
+   delete btdFile;
+   btdFile = NULL;
+}
+
+/** The records of a journal belonging to the current state of the data file
+  * get applied in the order they were written. The journal has to be closed
+  * during the replay, so the replayed changes don't get journaled again. The
+  * replay stops at the first incomplete or invalid record.
+  * @sa Journal::RecordType
+  */
+void DataWidget::replayJournal() {
+   QFile file(Journal::journalFilename(filename));
+   if (!file.open(QIODevice::ReadOnly)) {
+      return;
+   }
+   QDataStream in(&file);
+   if (!Journal::readHeader(in, filename)) {
+      return;
+   }
+
+   int changes = 0;
+   int maxID = -1;
+   bool valid = true;
+   quint8 type;
+   QByteArray payload;
+   while (valid && Journal::readRecord(in, type, payload)) {
+      QDataStream record(payload);
+      quint32 index, size, id;
+      qint32 firstFrame, lastFrame;
+      QString name;
+      switch (type) {
+      case Journal::CLEAR:
+         clearDataImmediate();
+         maxID = -1;
+         break;
+      case Journal::ADDCATEGORY:
+         record >> name;
+         addCategory(name);
+         break;
+      case Journal::RENAMECATEGORY:
+         record >> index;
+         record >> name;
+         valid = index < (quint32)categories.size();
+         if (valid) {
+            categories.at(index)->setName(name);
+            setTabText(index, name);
+         }
+         break;
+      case Journal::DELETECATEGORY:
+         record >> index;
+         valid = index < (quint32)categories.size();
+         if (valid) {
+            deleteCategoryImmediate(index);
+         }
+         break;
+      case Journal::SORTBYID:
+         sortByID();
+         break;
+      case Journal::SORTBYFN:
+         sortByFN();
+         break;
+      case Journal::ADDOBJECTS:
+         record >> index;
+         record >> size;
+         valid = index < (quint32)categories.size();
+         if (valid) {
+            QList<Object *> objects;
+            for (quint32 i=0; i<size; ++i) {
+               objects << objectStore->create(record);
+               maxID = qMax(maxID, objects.last()->getID());
+            }
+            categories.at(index)->addObjects(objects);
+         }
+         break;
+      case Journal::DELETEOBJECTS:
+         record >> size;
+         for (quint32 i=0; i<size; ++i) {
+            record >> id;
+            Category * const category = categoriesByID.value(id, NULL);
+            if (category) {
+               category->deleteObjectAt(category->findObject(id));
+            }
+         }
+         break;
+      case Journal::BBOXES:
+         record >> id;
+         record >> firstFrame;
+         record >> lastFrame;
+         record >> size;
+         if (Object * const object = getObject(id)) {
+            foreach (BBox const & bbox, object->getBBoxesInRange(firstFrame, lastFrame)) {
+               object->deleteBBoxAt(bbox.framenumber);
+            }
+            QList<BBox> bboxes;
+            BBox bbox;
+            quint8 bboxType;
+            quint32 framenumber;
+            for (quint32 i=0; i<size; ++i) {
+               record >> bboxType;
+               bbox.type = (BBox::Type)bboxType;
+               record >> framenumber;
+               bbox.framenumber = framenumber;
+               record >> bbox.rect;
+               bbox.objectID = id;
+               bboxes << bbox;
+            }
+            object->addBBoxes(bboxes);
+         }
+         break;
+      case Journal::VIDEO:
+         record >> videofileInfo.filename;
+         break;
+      default:
+         valid = false;
+      }
+      valid = valid && record.status() == QDataStream::Ok;
+      ++changes;
+   }
+
+   if (maxID >= 0) {
+      idCounter->reset(qMax(idCounter->getID(), maxID+1));
+   }
+   if (changes > 0) {
+      QMessageBox::information(this, tr("Changes recovered"), tr("%1 changes made to\n\"%2\"\nsince it was last saved have been recovered.")
+                                                             .arg(changes)
+                                                             .arg(filename.section('/', -1)));
+   }
+}
+
+/** The filename is taken from \ref filename. If this is empty saveFileAs() is called.
+  * The data is always saved in version 2 of the BTD format. It gets written to
+  * a temporary file first, which replaces the data file only once it is written
+  * completely and synced to the disk, so a failed save or a crash leaves either
+  * the old or the new data file and the journal intact.
+  * Afterwards the saved file stays mapped in place of the old one.
   * @sa void saveFileAs()
+  * @sa bool BTDFile::write(QIODevice & device, QString const & videoFilename, quint32 nextID, QList<Category *> const & categories)
   */
 void DataWidget::saveFile() {
    if (filename.isEmpty()) {
@@ -1142,26 +1569,43 @@ void DataWidget::saveFile() {
       return;
    }
 
-   // create/open file
-   QFile file(filename);
+   // create/open the temporary file
+   const QString tempFilename = filename+".tmp";
+   QFile file(tempFilename);
    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
       QMessageBox::warning(this, tr("Unable to access file"), tr("Unable to access file\n\"")
-                                                              +filename.section('/', -1)
+                                                              +tempFilename.section('/', -1)
                                                               +tr("\"\nfor writing!"));
       return;
    }
-   QDataStream out(&file);
+   if (!BTDFile::write(file, videofileInfo.filename, idCounter->getID(), categories) || !syncFile(file)) {
+      file.close();
+      file.remove();
+      QMessageBox::warning(this, tr("Unable to access file"), tr("Unable to write file\n\"")
+                                                              +tempFilename.section('/', -1)
+                                                              +tr("\"\ncompletely!"));
+      return;
+   }
+   file.close();
 
-   out << (quint8)'B';
-   out << (quint8)'T';
-   out << (quint8)'D';
-   out << (quint8)1;
-   out << videofileInfo.filename;
-   out << (quint32)idCounter->getID();
-   out << (quint32)categories.size();
-   foreach (Category const * const category, categories) {
-      category->save(out);
+   // objects not decoded yet get pointed to the saved file instead of copying their boxes
+   if (!rebaseBTDContent(tempFilename)) {
+      releaseBTDContent();
+   }
+   if (!replaceFile(tempFilename, filename)) {
+      // some systems can't rename mapped files
+      releaseBTDContent();
+      if (!replaceFile(tempFilename, filename)) {
+         QMessageBox::warning(this, tr("Unable to access file"), tr("The data got saved to\n\"")
+                                                                 +tempFilename.section('/', -1)
+                                                                 +tr("\"\nbut couldn't replace\n\"")
+                                                                 +filename.section('/', -1)
+                                                                 +tr("\"!"));
+         return;
+      }
    }
+   // all changes are saved, so the journal starts over
+   journal->open(filename, true);
 }
 
 /** The filename is asked from the user and saved in \ref filename
@@ -1229,7 +1673,7 @@ void DataWidget::selectNextKeyframe() {
       int i = cell.column;
       bool found = false;
       Object * object = categories.at(cell.index)->getObjects().at(cell.row);
-      BBox * bbox;
+      PackedBBox * bbox;
       while (i<videofileInfo.framecount && !found) {
          bbox = object->getBBoxPointer(++i);
          found = (bbox && bbox->type==BBox::KEYBOX);
@@ -1263,7 +1707,7 @@ void DataWidget::selectPreviousKeyframe() {
       bool found = false;
       Object * object = categories.at(cell.index)->getObject(selectedObjectID);
       while (i>0 && !found) {
-         found = object->getBBox(--i).type==BBox::KEYBOX;
+         found = object->getType(--i)==BBox::KEYBOX;
 
       }
       if (found) {
@@ -1304,18 +1748,10 @@ void DataWidget::setSelectedObject(int id) {
       int catNr = currentIndex();
       int row = -1;
 
-      if (id >= 0) {
-         bool found = false;
-         int i = 0;
-         while (!found && i<categories.size()) {
-            int j = categories.at(i)->findObject(id);
-            if (j >= 0) {
-               catNr = i;
-               row = j;
-               found = true;
-            }
-            ++i;
-         }
+      Category * const category = categoriesByID.value(id, NULL);
+      if (category) {
+         catNr = categories.indexOf(category);
+         row = category->findObject(id);
       }
 
       setSelection(catNr, row, currentFrameNr);
@@ -1326,7 +1762,7 @@ void DataWidget::setSelectedObject(int id) {
   *       selection
   */
 void DataWidget::setSelectedObjectByRow(int row) {
-   QTableView * tableView = static_cast<QTableView *>(currentWidget());
+   TimelineView * tableView = static_cast<TimelineView *>(currentWidget());
    QModelIndex index = categories.at(currentIndex())->index(row, currentFrameNr);
    if (index.isValid()) {
       tableView->setCurrentIndex(index);
@@ -1337,7 +1773,7 @@ void DataWidget::setSelectedObjectByRow(int row) {
   * the new selection.
   */
 void DataWidget::setSelection(int tab, int row, int column) {
-   QTableView * tableView = static_cast<QTableView *>(widget(tab));
+   TimelineView * tableView = static_cast<TimelineView *>(widget(tab));
    QModelIndex index = categories.at(tab)->index(row, column);
    setCurrentIndex(tab);
    if (index.isValid()) {
@@ -1355,6 +1791,9 @@ void DataWidget::setSelection(int tab, int row, int column) {
   * videos properties.
   */
 void DataWidget::setVFInfo(VideofileInfo const & newVideofileInfo) {
+   if (newVideofileInfo.filename != videofileInfo.filename) {
+      journal->videoChanged(newVideofileInfo.filename);
+   }
    videofileInfo = newVideofileInfo;
    foreach (Category * const category, categories) {
       category->setColumnCount(videofileInfo.framecount);
@@ -1371,6 +1810,7 @@ void DataWidget::sortByFN() {
    foreach (Category * category, categories) {
       category->sortByFN();
    }
+   journal->sorted(true);
 }
 
 /** Actually every category is told to sort itself
@@ -1380,6 +1820,17 @@ void DataWidget::sortByID() {
    foreach (Category * category, categories) {
       category->sortByID();
    }
+   journal->sorted(false);
+}
+
+/** @sa void registerObjects(Category * category, int first, int last)
+  */
+void DataWidget::unregisterObjects(Category * category, int first, int last) {
+   if (category) {
+      for (int row=first; row<=last; ++row) {
+         categoriesByID.remove(category->getObjects().at(row)->getID());
+      }
+   }
 }
 
 /** This is used to get a default width for the views if no video file is opened.
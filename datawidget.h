@@ -1,11 +1,14 @@
 #ifndef DATAWIDGET_H
 #define DATAWIDGET_H
 
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
 #include <QtGui/QTabWidget>
 #include <QtGui/QItemSelection>
 #include "types.h"
 
 class Category;
+class Journal;
 class Object;
 class QFile;
 class QAbstractButton;
@@ -60,6 +63,8 @@ public:
    Object * getObject(int id) const;
    /// Setter for the \ref videofileInfo
    void setVFInfo(VideofileInfo const & newVideofileInfo);
+   /// Getter for the \ref filename
+   QString getFilename() const;
    /// Returns the recommended minimum size for the widget.
    virtual QSize minimumSizeHint() const;
    /// Returns if a object is selected
@@ -110,6 +115,10 @@ signals:
      * @sa void MainWindow::updateActions()
      */
    void updateActions();
+   /// Gets emitted whenever any tracking data changed, got added or removed.
+   /** Views caching tracking data can use it to mark their caches as outdated.
+     */
+   void dataModified();
 
 public slots:
    /// Opens a data file
@@ -160,14 +169,18 @@ public slots:
    void selectPreviousCategory();
 
 private:
-   int zoom;                     ///< The width of one box in the data view.
-   int currentFrameNr;           ///< Number of the currently selected frame.
-   int selectedObjectID;         ///< ID of the currently selected object.
-   QString filename;             ///< Filename of the current data file.
-   VideofileInfo videofileInfo;  ///< VideoFileInfo struct from the current video file
-   QList<Category *> categories; ///< The list of categories
-   QButtonGroup * closeBtnGroup; ///< Group to organize the close category buttons
-   QButtonGroup * editBtnGroup;  ///< Group to organize the edit category buttons
+   int zoom;                              ///< The width of one box in the data view.
+   int currentFrameNr;                    ///< Number of the currently selected frame.
+   int selectedObjectID;                  ///< ID of the currently selected object.
+   QString filename;                      ///< Filename of the current data file.
+   VideofileInfo videofileInfo;           ///< VideoFileInfo struct from the current video file
+   QList<Category *> categories;          ///< The list of categories
+   QHash<int, Category *> categoriesByID; ///< The category of each object by its ID
+   QButtonGroup * closeBtnGroup;          ///< Group to organize the close category buttons
+   QButtonGroup * editBtnGroup;           ///< Group to organize the edit category buttons
+   Journal * journal;                     ///< Log of the changes made since the last save
+   QFile * btdFile;                       ///< The opened data file while it is mapped into memory
+   QByteArray btdContent;                 ///< Content of the data file the objects not decoded yet refer to
 
    /// Deletes all tracking data without further warning
    void clearDataImmediate();
@@ -177,16 +190,20 @@ private:
    Category * addCategory(QString const & name);
    /// Deletes the category with the given \a index
    void deleteCategory(int index);
+   /// Deletes the category with the given \a index without further warning
+   void deleteCategoryImmediate(int index);
    /// Enables the user to edit the category with the given \a index
    void editCategory(int index);
    /// Adds the \a object to the category specified by \a catName.
    void addObject(Object * object, QString const & catName);
+   /// Adds the \a objects to the category specified by \a catName at once.
+   void addObjects(QList<Object *> const & objects, QString const & catName);
    /// Imports tracking data from a ViPER file
    void importViperFile(QFile & file);
    /// Imports tracking data from a BB file
    void importBBFile(QFile & file);
-   /// Exports tracking data as a ViPER file
-   void exportViperFile(QFile & file);
+   /// Exports tracking data as a ViPER file, returns false if the user aborted.
+   bool exportViperFile(QFile & file);
    /// Exports tracking data as a BB file
    void exportBBFile(QFile & file);
    /// Sets the selection
@@ -201,6 +218,16 @@ private:
    QList<int> getSelectedRows() const;
    /// Determines and sets the maximum framecount of all objects.
    void updateFramecount();
+   /// Registers the objects from row \a first to \a last of the \a category in #categoriesByID.
+   void registerObjects(Category * category, int first, int last);
+   /// Removes the objects from row \a first to \a last of the \a category from #categoriesByID.
+   void unregisterObjects(Category * category, int first, int last);
+   /// Maps the saved file \a savedFilename and points the objects not decoded yet to it.
+   bool rebaseBTDContent(QString const & savedFilename);
+   /// Releases the #btdContent after the objects not decoded yet copied their boxes.
+   void releaseBTDContent();
+   /// Applies the changes recorded in the journal of the current data file.
+   void replayJournal();
 
 private slots:
    /// Adapter from the selectionChanged Signal from the ListView to the one from this class.
@@ -211,8 +238,14 @@ private slots:
    void editCategory(QAbstractButton * button);
    /// Gets called when the current tab changes to \a index
    void onCurrentTabChanged(int index);
-   /// Called to change the zoomlevel of the TableView to \a newZoom
+   /// Called to change the zoomlevel of the TimelineViews to \a newZoom
    void changeZoom(int newZoom);
+   /// Warns that the objects with the given \a objectIDs are damaged.
+   void objectsDamaged(QList<int> const & objectIDs);
+   /// Registers objects inserted into the sending category.
+   void objectsInserted(QModelIndex const & parent, int first, int last);
+   /// Unregisters objects about to be removed from the sending category.
+   void objectsAboutToBeRemoved(QModelIndex const & parent, int first, int last);
 };
 
 /// Creates a inactive pixmap of the given ressource \a name
@@ -0,0 +1,55 @@
+#include "filesync.h"
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QString>
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <windows.h>
+#else
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/** QFile::flush() only hands the data to the operating system, which might
+  * still lose it on a power failure. This also forces it out of the caches of
+  * the operating system, so it should only be called when the data has to be
+  * safe, not on every write.
+  */
+bool syncFile(QFile & file) {
+   if (!file.flush()) {
+      return false;
+   }
+#ifdef Q_OS_WIN
+   return FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(file.handle())));
+#else
+   return ::fsync(file.handle()) == 0;
+#endif
+}
+
+/** Unlike removing \a filename and renaming \a newFilename afterwards, there
+  * is no moment in which neither file exists, so a crash leaves either the old
+  * or the new file under \a filename. On POSIX systems the directory gets
+  * synced as well, so the rename itself survives a power failure. The new file
+  * should have been synced with syncFile() before.
+  */
+bool replaceFile(QString const & newFilename, QString const & filename) {
+#ifdef Q_OS_WIN
+   return MoveFileExW(reinterpret_cast<wchar_t const *>(QDir::toNativeSeparators(newFilename).utf16()),
+                      reinterpret_cast<wchar_t const *>(QDir::toNativeSeparators(filename).utf16()),
+                      MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+   if (::rename(QFile::encodeName(newFilename).constData(), QFile::encodeName(filename).constData()) != 0) {
+      return false;
+   }
+   const QString dirname = QFileInfo(filename).absolutePath();
+   const int dir = ::open(QFile::encodeName(dirname).constData(), O_RDONLY);
+   if (dir >= 0) {
+      // some file systems can't sync directories, the file got replaced anyway
+      ::fsync(dir);
+      ::close(dir);
+   }
+   return true;
+#endif
+}
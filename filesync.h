@@ -0,0 +1,12 @@
+#ifndef FILESYNC_H
+#define FILESYNC_H
+
+class QFile;
+class QString;
+
+/// Writes the buffered data of the opened \a file through to the disk, returns false if that fails.
+bool syncFile(QFile & file);
+/// Atomically replaces the file \a filename by the file \a newFilename, returns false if that fails.
+bool replaceFile(QString const & newFilename, QString const & filename);
+
+#endif // FILESYNC_H
@@ -0,0 +1,89 @@
+#include "framecache.h"
+
+/** The costs are measured in kilobytes, so even large budgets fit into the
+  * integer costs of
+  * <a href="http://qt-project.org/doc/qt-4.8/qcache.html">QCache</a>.
+  */
+FrameCache::FrameCache(int megabytes) :
+   frames(megabytes*1024), hits(0), misses(0), evictions(0)
+{
+}
+
+/** The statistics are kept.
+  */
+void FrameCache::clear() {
+   frames.clear();
+}
+
+/** This doesn't count as a lookup, so neither the statistics nor the order of
+  * eviction change.
+  */
+bool FrameCache::contains(int frame) const {
+   return frames.contains(frame);
+}
+
+int FrameCache::count() const {
+   return frames.count();
+}
+
+int FrameCache::getBudget() const {
+   return frames.maxCost()/1024;
+}
+
+int FrameCache::getEvictions() const {
+   return evictions;
+}
+
+int FrameCache::getHits() const {
+   return hits;
+}
+
+int FrameCache::getMisses() const {
+   return misses;
+}
+
+int FrameCache::getUsage() const {
+   return frames.totalCost();
+}
+
+/** An already cached frame gets replaced. If the frame alone exceeds the
+  * budget it doesn't get cached at all.
+  */
+void FrameCache::insert(int frame, cv::Mat const & mat) {
+   const int cost = qMax(1, int(mat.step[0]*mat.rows/1024));
+   const int before = frames.count() + (frames.contains(frame) ? 0 : 1);
+   if (frames.insert(frame, new cv::Mat(mat), cost)) {
+      evictions += before-frames.count();
+   }
+}
+
+/** A hit marks the frame as most recently used.
+  * @note The image data is shared with the cache, so it must not be altered.
+  */
+bool FrameCache::lookup(int frame, cv::Mat & mat) {
+   cv::Mat const * const cached = frames.object(frame);
+   if (cached) {
+      mat = *cached;
+      ++hits;
+      return true;
+   }
+   else {
+      ++misses;
+      return false;
+   }
+}
+
+void FrameCache::resetStatistics() {
+   hits = 0;
+   misses = 0;
+   evictions = 0;
+}
+
+/** If the cache exceeds the new budget the least recently used frames get
+  * evicted immediately.
+  */
+void FrameCache::setBudget(int megabytes) {
+   const int before = frames.count();
+   frames.setMaxCost(qMax(1, megabytes)*1024);
+   evictions += before-frames.count();
+}
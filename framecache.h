@@ -0,0 +1,51 @@
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include <QtCore/QCache>
+#include <opencv2/core/core.hpp>
+
+/// A least recently used cache for decoded video frames.
+/** The frames are keyed by their framenumber and the size of the cache is
+  * limited by a memory budget instead of a number of frames, so the same
+  * setting fits videos of any resolution. When the budget is exceeded the
+  * least recently used frames get evicted. The cache also counts hits, misses
+  * and evictions, which can be used to tune the budget.
+  */
+class FrameCache {
+
+public:
+   /// Creates a cache with a budget of \a megabytes.
+   explicit FrameCache(int megabytes = 256);
+   /// Looks up the frame with the number \a frame and copies it to \a mat.
+   bool lookup(int frame, cv::Mat & mat);
+   /// Adds the image \a mat of the frame with the number \a frame.
+   void insert(int frame, cv::Mat const & mat);
+   /// Returns whether the frame with the number \a frame is cached.
+   bool contains(int frame) const;
+   /// Removes all frames.
+   void clear();
+   /// Sets the budget to \a megabytes.
+   void setBudget(int megabytes);
+   /// Returns the budget in megabytes.
+   int getBudget() const;
+   /// Returns the memory currently used by the cached frames in kilobytes.
+   int getUsage() const;
+   /// Returns the number of cached frames.
+   int count() const;
+   /// Getter for #hits.
+   int getHits() const;
+   /// Getter for #misses.
+   int getMisses() const;
+   /// Getter for #evictions.
+   int getEvictions() const;
+   /// Resets the hit, miss and eviction counters.
+   void resetStatistics();
+
+private:
+   QCache<int, cv::Mat> frames; ///< The frames, the cost of a frame is its size in kilobytes
+   int hits;                    ///< Number of successful lookups
+   int misses;                  ///< Number of failed lookups
+   int evictions;               ///< Number of frames evicted to stay within the budget
+};
+
+#endif // FRAMECACHE_H
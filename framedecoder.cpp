@@ -0,0 +1,369 @@
+#include "framedecoder.h"
+#include <QtCore/QMutexLocker>
+
+/** The thread doesn't get started until a video is opened.
+  */
+FrameDecoder::FrameDecoder(QObject * parent) :
+   QThread(parent),
+   ringStart(0),
+   ringSize(16),
+   requested(-1),
+   endFrame(0),
+   generation(0),
+   direction(FORWARD),
+   seekPending(false),
+   abort(false),
+   droppedFrames(0),
+   framecount(0),
+   framerate(0.0),
+   frameSize(QSize()),
+   capturePos(-1)
+{
+}
+
+FrameDecoder::~FrameDecoder() {
+   stop();
+}
+
+/** All decoded frames get discarded.
+  */
+void FrameDecoder::close() {
+   stop();
+   capture.release();
+   ring.clear();
+   framecount = 0;
+   framerate = 0.0;
+   frameSize = QSize();
+   keyframes.clear();
+}
+
+/** The chunk ends right before the #ring and starts at the last keyframe
+  * before, but contains #ringSize frames at most. It gets decoded into a
+  * separate list without holding the lock, which is prepended to the ring
+  * afterwards, unless the ring got discarded meanwhile.
+  */
+void FrameDecoder::decodeChunk(QMutexLocker & locker) {
+   const int end = ringStart-1;
+   const int start = qMax(qMax(0, end-ringSize+1), keyframes.keyframeBefore(end));
+   const int currentGeneration = generation;
+   locker.unlock();
+
+   QList<RingEntry> chunk;
+   bool ok = seekTo(start, currentGeneration);
+   for (int frame=start; ok && frame<=end; ++frame) {
+      cv::Mat mat;
+      ok = capture.read(mat) && !mat.empty();
+      capturePos = ok ? capturePos+1 : -1;
+      if (ok) {
+         // the capture reuses its buffer for the next frame
+         chunk << RingEntry(mat.clone());
+         QMutexLocker generationLocker(&mutex);
+         ok = currentGeneration == generation;
+      }
+   }
+
+   locker.relock();
+   if (currentGeneration != generation) {
+      return;
+   }
+   if (!ok) {
+      // broken video, wait for the next request to try again
+      requested = -1;
+      return;
+   }
+   while (!chunk.isEmpty()) {
+      ring.prepend(chunk.takeLast());
+      --ringStart;
+   }
+   for (int frame=start; frame<=end; ++frame) {
+      emit frameDecoded(frame);
+   }
+}
+
+/** Frames that never got fetched are counted as dropped.
+  */
+void FrameDecoder::discardRing() {
+   while (!ring.isEmpty()) {
+      popFront();
+   }
+   ++generation;
+}
+
+/** If the frame isn't (yet) part of the ring, false is returned and \a mat
+  * stays untouched.
+  * @note The image data is shared with the ring, so it must not be altered.
+  */
+bool FrameDecoder::fetchFrame(int frame, cv::Mat & mat) {
+   QMutexLocker locker(&mutex);
+   const int i = frame-ringStart;
+   if (i<0 || i>=ring.size()) {
+      return false;
+   }
+   mat = ring.at(i).mat;
+   ring[i].fetched = true;
+   return true;
+}
+
+/** These are the frames the thread decoded in advance.
+  */
+int FrameDecoder::getDepth() const {
+   QMutexLocker locker(&mutex);
+   if (direction == BACKWARD) {
+      return qMax(0, requested-ringStart);
+   }
+   return qMax(0, ringStart+ring.size()-1-requested);
+}
+
+/** This is the frame the thread is currently working on, or would work on if
+  * the ring wasn't full.
+  */
+int FrameDecoder::getDecodedEnd() const {
+   QMutexLocker locker(&mutex);
+   return ringStart+ring.size();
+}
+
+/** Dropped frames are frames that got decoded but discarded before they were
+  * ever fetched, e.g. because playback skipped them or a seek happened. A high
+  * number indicates a ring that is too big or a machine that is too slow.
+  */
+int FrameDecoder::getDroppedFrames() const {
+   QMutexLocker locker(&mutex);
+   return droppedFrames;
+}
+
+int FrameDecoder::getFramecount() const {
+   return framecount;
+}
+
+double FrameDecoder::getFramerate() const {
+   return framerate;
+}
+
+QSize FrameDecoder::getFrameSize() const {
+   return frameSize;
+}
+
+int FrameDecoder::getRingSize() const {
+   QMutexLocker locker(&mutex);
+   return ringSize;
+}
+
+bool FrameDecoder::isOpened() const {
+   return capture.isOpened();
+}
+
+/** A frame stops being pending once it got superseded by another request or
+  * decoding it failed, in which case it won't be delivered via frameDecoded().
+  */
+bool FrameDecoder::isPending(int frame) const {
+   QMutexLocker locker(&mutex);
+   if (frame != requested) {
+      return false;
+   }
+   // a failed chunk resets the request, a failed read marks the end of the video
+   return direction == BACKWARD || frame < endFrame;
+}
+
+/** A possibly running decoding is stopped first. The properties of the video
+  * get read once here, so they can be queried without touching the capture
+  * afterwards. If the keyframe \a index is invalid, seeking is left to the
+  * capture.
+  */
+bool FrameDecoder::open(QString const & filename, KeyframeIndex const & index) {
+   close();
+   capture.open(filename.toStdString());
+   if (!capture.isOpened()) {
+      return false;
+   }
+
+   framecount = capture.get(CV_CAP_PROP_FRAME_COUNT);
+   framerate = capture.get(CV_CAP_PROP_FPS);
+   frameSize = QSize(capture.get(CV_CAP_PROP_FRAME_WIDTH),
+                     capture.get(CV_CAP_PROP_FRAME_HEIGHT));
+
+   keyframes = index;
+   capturePos = 0;
+   direction = FORWARD;
+   ringStart = 0;
+   requested = -1;
+   endFrame = framecount;
+   seekPending = false;
+   abort = false;
+   resetStatistics();
+   start();
+   return true;
+}
+
+/** Frames that never got fetched are counted as dropped.
+  */
+void FrameDecoder::popBack() {
+   if (!ring.takeLast().fetched) {
+      ++droppedFrames;
+   }
+}
+
+/** Frames that never got fetched are counted as dropped.
+  */
+void FrameDecoder::popFront() {
+   if (!ring.takeFirst().fetched) {
+      ++droppedFrames;
+   }
+   ++ringStart;
+}
+
+/** Going FORWARD, frames before \a frame get removed from the ring. If
+  * \a frame lies outside of the ring (or isn't the next frame to decode) the
+  * whole ring is discarded and the thread seeks to \a frame.
+  * Going BACKWARD, frames after \a frame get removed from the ring instead. If
+  * \a frame is neither part of the ring nor of the chunk currently decoded, the
+  * ring is discarded and the next chunk ends at \a frame.
+  * Changing the direction always discards the ring.
+  * A failed read only marks the end of the video until the next seek, so a
+  * single failed seek doesn't stop the decoding for good.
+  */
+void FrameDecoder::request(int frame, Direction newDirection) {
+   QMutexLocker locker(&mutex);
+   requested = frame;
+   if (newDirection != direction) {
+      direction = newDirection;
+      discardRing();
+      ringStart = direction == FORWARD ? frame : frame+1;
+      seekPending = direction == FORWARD;
+      endFrame = framecount;
+   }
+   else if (direction == FORWARD) {
+      if (frame>=ringStart && frame<=ringStart+ring.size()) {
+         while (ringStart<frame) {
+            popFront();
+         }
+      }
+      else {
+         discardRing();
+         ringStart = frame;
+         seekPending = true;
+         endFrame = framecount;
+      }
+   }
+   else {
+      if (frame>=ringStart-ringSize && frame<ringStart+ring.size()) {
+         while (!ring.isEmpty() && ringStart+ring.size()-1>frame) {
+            popBack();
+         }
+      }
+      else {
+         discardRing();
+         ringStart = frame+1;
+      }
+   }
+   condition.wakeOne();
+}
+
+void FrameDecoder::resetStatistics() {
+   QMutexLocker locker(&mutex);
+   droppedFrames = 0;
+}
+
+/** The capture is only accessed without holding the lock, so the GUI thread
+  * never blocks on decoding. If the ring got discarded while a frame was being
+  * decoded, said frame gets thrown away.
+  * Going BACKWARD, the next chunk gets decoded as soon as less than #ringSize
+  * frames are left before the requested one.
+  */
+void FrameDecoder::run() {
+   QMutexLocker locker(&mutex);
+   while (!abort) {
+      if (direction == BACKWARD) {
+         if (requested<0 || ringStart<=0 || requested-ringStart>=ringSize) {
+            condition.wait(&mutex);
+         }
+         else {
+            decodeChunk(locker);
+         }
+         continue;
+      }
+
+      const int frame = ringStart+ring.size();
+      if (requested<0 || ring.size()>=ringSize || frame>=endFrame) {
+         condition.wait(&mutex);
+         continue;
+      }
+      const int currentGeneration = generation;
+      const bool seek = seekPending;
+      seekPending = false;
+      locker.unlock();
+
+      cv::Mat mat;
+      bool ok = !seek || seekTo(frame, currentGeneration);
+      if (ok) {
+         ok = capture.read(mat);
+         capturePos = ok ? capturePos+1 : -1;
+      }
+
+      locker.relock();
+      if (currentGeneration != generation) {
+         continue;
+      }
+      if (!ok || mat.empty()) {
+         // broken or truncated video, don't try again before the next seek
+         endFrame = frame;
+         continue;
+      }
+      // the capture reuses its buffer for the next frame
+      ring << RingEntry(mat.clone());
+      emit frameDecoded(frame);
+   }
+}
+
+/** With a valid keyframe index the capture only seeks if it isn't already
+  * positioned between the last keyframe before \a frame and \a frame, then the
+  * remaining frames get grabbed without being converted. Returns false if
+  * another seek was requested meanwhile.
+  * @note Must be called without holding the lock.
+  */
+bool FrameDecoder::seekTo(int frame, int seekGeneration) {
+   const int keyframe = keyframes.keyframeBefore(frame);
+   if (keyframe < 0) {
+      if (capturePos != frame) {
+         capture.set(CV_CAP_PROP_POS_FRAMES, frame);
+         capturePos = frame;
+      }
+      return true;
+   }
+
+   if (capturePos < keyframe || capturePos > frame) {
+      capture.set(CV_CAP_PROP_POS_FRAMES, keyframe);
+      capturePos = keyframe;
+   }
+   while (capturePos < frame) {
+      if (!capture.grab()) {
+         // let the following read fail
+         capturePos = -1;
+         return true;
+      }
+      ++capturePos;
+      QMutexLocker locker(&mutex);
+      if (generation != seekGeneration) {
+         return false;
+      }
+   }
+   return true;
+}
+
+/** Frames already in the ring exceeding the new \a size are kept until they
+  * get consumed.
+  */
+void FrameDecoder::setRingSize(int size) {
+   QMutexLocker locker(&mutex);
+   ringSize = qMax(1, size);
+   condition.wakeOne();
+}
+
+void FrameDecoder::stop() {
+   if (isRunning()) {
+      mutex.lock();
+      abort = true;
+      condition.wakeOne();
+      mutex.unlock();
+      wait();
+   }
+}
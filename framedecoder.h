@@ -0,0 +1,124 @@
+#ifndef FRAMEDECODER_H
+#define FRAMEDECODER_H
+
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QSize>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+#include <opencv2/highgui/highgui.hpp>
+#include "keyframeindex.h"
+
+/// Thread decoding the frames of a video ahead of the currently shown one.
+/** The decoder owns the OpenCV capture and keeps a bounded ring of decoded
+  * frames starting at the last requested frame. The GUI thread requests a
+  * frame with request() and gets informed via frameDecoded() as soon as it is
+  * available, it then can be fetched with fetchFrame(). While idle the thread
+  * keeps decoding the following frames until the ring is full.
+  * If a KeyframeIndex is available, seeks start at the last keyframe before
+  * the requested frame, so they don't depend on the capture's own (often slow
+  * or inexact) seeking.
+  * When stepping backwards, the decoder switches to the BACKWARD direction:
+  * the ring then grows towards the beginning of the video by decoding whole
+  * chunks (ending at the keyframe boundaries) at once, which are served in
+  * reverse order while the previous chunk gets decoded in the background.
+  */
+class FrameDecoder : public QThread {
+
+   Q_OBJECT
+
+public:
+   /// The direction the frames are requested in
+   enum Direction {
+      FORWARD=0, ///< Frames are requested in ascending order
+      BACKWARD   ///< Frames are requested in descending order
+   };
+
+   /// Default c'tor.
+   explicit FrameDecoder(QObject * parent = 0);
+   /// Stops the thread and releases the capture.
+   ~FrameDecoder();
+   /// Opens the video file with the given \a filename and starts decoding.
+   bool open(QString const & filename, KeyframeIndex const & index = KeyframeIndex());
+   /// Stops decoding and releases the capture.
+   void close();
+   /// Returns whether a video is opened.
+   bool isOpened() const;
+   /// Getter for #framecount.
+   int getFramecount() const;
+   /// Getter for #framerate.
+   double getFramerate() const;
+   /// Getter for #frameSize.
+   QSize getFrameSize() const;
+   /// Requests the frame with the number \a frame to be decoded, the following ones are expected in \a newDirection.
+   void request(int frame, Direction newDirection = FORWARD);
+   /// Copies the decoded \a frame to \a mat if it is available.
+   bool fetchFrame(int frame, cv::Mat & mat);
+   /// Returns whether the \a frame is requested and still expected to get decoded.
+   bool isPending(int frame) const;
+   /// Returns the number of the first frame that isn't decoded yet.
+   int getDecodedEnd() const;
+   /// Sets the capacity of the ring to \a size frames.
+   void setRingSize(int size);
+   /// Getter for #ringSize.
+   int getRingSize() const;
+   /// Returns the number of frames decoded ahead of (or behind when going backwards) the requested one.
+   int getDepth() const;
+   /// Getter for #droppedFrames.
+   int getDroppedFrames() const;
+   /// Resets the statistics.
+   void resetStatistics();
+
+signals:
+   /// Gets emitted from the decoder thread whenever a frame got decoded.
+   /** The frame with the number \a frame can be fetched via fetchFrame().
+     */
+   void frameDecoded(int frame);
+
+protected:
+   /// The decoding loop.
+   void run();
+
+private:
+   /// A decoded frame in the ring.
+   struct RingEntry {
+      cv::Mat mat;  ///< The image data
+      bool fetched; ///< Indicates whether the frame was fetched at least once
+      /// Constructs an entry holding \a mat.
+      explicit RingEntry(cv::Mat const & mat) : mat(mat), fetched(false) {}
+   };
+
+   cv::VideoCapture capture; ///< The OpenCV capture holding the video data
+   mutable QMutex mutex;     ///< Guards all members shared with the thread
+   QWaitCondition condition; ///< Wakes the thread when there is work
+   QList<RingEntry> ring;    ///< Consecutive decoded frames starting at #ringStart
+   int ringStart;            ///< Number of the first frame in the #ring
+   int ringSize;             ///< Maximum number of frames in the #ring
+   int requested;            ///< Number of the last requested frame
+   int endFrame;             ///< Number of the first frame that can't be decoded
+   int generation;           ///< Gets increased whenever the #ring is discarded
+   Direction direction;      ///< The direction of the last request
+   bool seekPending;         ///< Indicates that the capture has to seek to #ringStart
+   bool abort;               ///< Tells the thread to quit
+   int droppedFrames;        ///< Number of frames decoded but discarded unseen
+   int framecount;           ///< Number of frames of the video
+   double framerate;         ///< Framerate of the video
+   QSize frameSize;          ///< Resolution of the video
+   KeyframeIndex keyframes;  ///< The keyframes of the video, only used by the thread
+   int capturePos;           ///< Number of the frame the capture reads next, only used by the thread
+
+   /// Stops the thread and waits for it to finish.
+   void stop();
+   /// Removes the first entry of the #ring.
+   void popFront();
+   /// Removes the last entry of the #ring.
+   void popBack();
+   /// Removes all entries of the #ring and starts a new #generation.
+   void discardRing();
+   /// Decodes the chunk of frames preceding the #ring.
+   void decodeChunk(QMutexLocker & locker);
+   /// Moves the capture to \a frame unless the seek of \a seekGeneration gets superseded.
+   bool seekTo(int frame, int seekGeneration);
+};
+
+#endif // FRAMEDECODER_H
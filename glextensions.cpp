@@ -0,0 +1,68 @@
+#include "glextensions.h"
+#include <QtCore/QStringList>
+
+/// Resolves the function \a name, or its ARB variant if the core one is missing.
+inline void * resolveFunction(QGLContext const * context, char const * name) {
+   void * function = context->getProcAddress(QLatin1String(name));
+   if (!function) {
+      function = context->getProcAddress(QLatin1String(name)+"ARB");
+   }
+   return function;
+}
+
+GLExtensions::GLExtensions() :
+   bufferObjects(false),
+   pixelBufferObjects(false),
+   npotTextures(false),
+   rectangleTextures(false),
+   genBuffers(NULL),
+   deleteBuffers(NULL),
+   bindBuffer(NULL),
+   bufferData(NULL),
+   bufferSubData(NULL),
+   mapBuffer(NULL),
+   unmapBuffer(NULL)
+{
+}
+
+/** The extension string is only meaningful with a current context.
+  */
+bool GLExtensions::hasExtension(char const * name) {
+   char const * extensions = reinterpret_cast<char const *>(glGetString(GL_EXTENSIONS));
+   return extensions && QString(extensions).split(' ').contains(QLatin1String(name));
+}
+
+/** The version string starts with "major.minor", optionally followed by a
+  * release number and vendor information.
+  */
+bool GLExtensions::hasVersion(int major, int minor) {
+   char const * version = reinterpret_cast<char const *>(glGetString(GL_VERSION));
+   if (!version) {
+      return false;
+   }
+   QStringList numbers = QString(version).section(' ', 0, 0).split('.');
+   const int contextMajor = numbers.value(0).toInt();
+   const int contextMinor = numbers.value(1).toInt();
+   return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+}
+
+/** The \a context has to be current.
+  */
+void GLExtensions::resolve(QGLContext const * context) {
+   genBuffers = (PFNGLGENBUFFERSPROC)resolveFunction(context, "glGenBuffers");
+   deleteBuffers = (PFNGLDELETEBUFFERSPROC)resolveFunction(context, "glDeleteBuffers");
+   bindBuffer = (PFNGLBINDBUFFERPROC)resolveFunction(context, "glBindBuffer");
+   bufferData = (PFNGLBUFFERDATAPROC)resolveFunction(context, "glBufferData");
+   bufferSubData = (PFNGLBUFFERSUBDATAPROC)resolveFunction(context, "glBufferSubData");
+   mapBuffer = (PFNGLMAPBUFFERPROC)resolveFunction(context, "glMapBuffer");
+   unmapBuffer = (PFNGLUNMAPBUFFERPROC)resolveFunction(context, "glUnmapBuffer");
+
+   bufferObjects = (hasVersion(1, 5) || hasExtension("GL_ARB_vertex_buffer_object")) &&
+                   genBuffers && deleteBuffers && bindBuffer && bufferData && bufferSubData &&
+                   mapBuffer && unmapBuffer;
+   pixelBufferObjects = bufferObjects &&
+                        (hasVersion(2, 1) || hasExtension("GL_ARB_pixel_buffer_object"));
+   npotTextures = hasVersion(2, 0) || hasExtension("GL_ARB_texture_non_power_of_two");
+   rectangleTextures = hasVersion(3, 1) || hasExtension("GL_ARB_texture_rectangle") ||
+                       hasExtension("GL_EXT_texture_rectangle") || hasExtension("GL_NV_texture_rectangle");
+}
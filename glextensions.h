@@ -0,0 +1,37 @@
+#ifndef GLEXTENSIONS_H
+#define GLEXTENSIONS_H
+
+#include <QtOpenGL/QGLContext>
+#include <GL/glext.h>
+
+/// OpenGL entry points and capabilities beyond OpenGL 1.1.
+/** The entry points get resolved at runtime via QGLContext::getProcAddress(),
+  * since e.g. Windows only exports OpenGL 1.1. If a feature is neither part of
+  * the context's core version nor available as an extension, its flag stays
+  * false and the caller has to use a fallback. This keeps TrackIt working on
+  * software renderers like Mesa, too.
+  */
+struct GLExtensions {
+   bool bufferObjects;                   ///< Indicates whether buffer objects (OpenGL 1.5) are available
+   bool pixelBufferObjects;              ///< Indicates whether pixel buffer objects (OpenGL 2.1) are available
+   bool npotTextures;                    ///< Indicates whether 2D textures may have any size (OpenGL 2.0)
+   bool rectangleTextures;               ///< Indicates whether rectangle textures are available
+   PFNGLGENBUFFERSPROC genBuffers;       ///< glGenBuffers
+   PFNGLDELETEBUFFERSPROC deleteBuffers; ///< glDeleteBuffers
+   PFNGLBINDBUFFERPROC bindBuffer;       ///< glBindBuffer
+   PFNGLBUFFERDATAPROC bufferData;       ///< glBufferData
+   PFNGLBUFFERSUBDATAPROC bufferSubData; ///< glBufferSubData
+   PFNGLMAPBUFFERPROC mapBuffer;         ///< glMapBuffer
+   PFNGLUNMAPBUFFERPROC unmapBuffer;     ///< glUnmapBuffer
+
+   /// Constructs a struct without any features.
+   GLExtensions();
+   /// Resolves the entry points of the current \a context.
+   void resolve(QGLContext const * context);
+   /// Returns whether the current context supports at least version \a major.\a minor.
+   static bool hasVersion(int major, int minor);
+   /// Returns whether the current context supports the extension \a name.
+   static bool hasExtension(char const * name);
+};
+
+#endif // GLEXTENSIONS_H
@@ -0,0 +1,275 @@
+#include "journal.h"
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTimer>
+#include "datawidget.h"
+#include "filesync.h"
+#include "object.h"
+#include "objectstore.h"
+
+const qint64 Journal::minimumCompactionSize;
+
+/** The journal only records changes after it got opened.
+  */
+Journal::Journal(DataWidget * data) :
+   QObject(data), data(data), compactionSize(minimumCompactionSize),
+   flushTimer(new QTimer(this))
+{
+   flushTimer->setSingleShot(true);
+   flushTimer->setInterval(1000);
+   connect(flushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+   connect(objectStore, SIGNAL(dataChanged(int,int,int)), this, SLOT(objectDataChanged(int,int,int)));
+}
+
+Journal::~Journal() {
+   close();
+}
+
+void Journal::categoryAdded(QString const & name) {
+   QByteArray payload;
+   QDataStream out(&payload, QIODevice::WriteOnly);
+   out << name;
+   writeRecord(ADDCATEGORY, payload);
+}
+
+void Journal::categoryDeleted(int index) {
+   QByteArray payload;
+   QDataStream out(&payload, QIODevice::WriteOnly);
+   out << (quint32)index;
+   writeRecord(DELETECATEGORY, payload);
+}
+
+void Journal::categoryRenamed(int index, QString const & name) {
+   QByteArray payload;
+   QDataStream out(&payload, QIODevice::WriteOnly);
+   out << (quint32)index;
+   out << name;
+   writeRecord(RENAMECATEGORY, payload);
+}
+
+/** If the journal is not open nothing happens. Unlike flush() this never
+  * requests a compaction.
+  */
+void Journal::close() {
+   if (file.isOpen()) {
+      writeDirtyRanges();
+      syncFile(file);
+      file.close();
+   }
+   flushTimer->stop();
+   dirtyRanges.clear();
+}
+
+/** Nothing gets written to the disk here, the ranges are written with the next
+  * record or flush(). Changes of objects not belonging to any category yet get
+  * dropped there, as the objects get recorded as a whole when they are added.
+  */
+void Journal::objectDataChanged(int objectID, int firstFrame, int lastFrame) {
+   if (!file.isOpen()) {
+      return;
+   }
+   QHash<int, QPair<int, int> >::iterator range = dirtyRanges.find(objectID);
+   if (range == dirtyRanges.end()) {
+      dirtyRanges.insert(objectID, qMakePair(firstFrame, lastFrame));
+   }
+   else {
+      range.value().first = qMin(range.value().first, firstFrame);
+      range.value().second = qMax(range.value().second, lastFrame);
+   }
+   if (!flushTimer->isActive()) {
+      flushTimer->start();
+   }
+}
+
+/** The journal file gets synced to the disk, so the records survive a crash of
+  * the application or the system. If the journal got too large
+  * compactionNeeded() gets emitted.
+  */
+void Journal::flush() {
+   if (!file.isOpen()) {
+      return;
+   }
+   writeDirtyRanges();
+   syncFile(file);
+   if (file.size() > compactionSize) {
+      emit compactionNeeded();
+   }
+}
+
+bool Journal::isOpen() const {
+   return file.isOpen();
+}
+
+/** The journal is named like the BTD file with an additional \c .btj suffix.
+  */
+QString Journal::journalFilename(QString const & btdFilename) {
+   return btdFilename+".btj";
+}
+
+/** The objects are recorded completely in the BTD format, so pending box
+  * changes of them are dropped.
+  */
+void Journal::objectsAdded(int index, QList<Object *> const & objects) {
+   if (!file.isOpen()) {
+      return;
+   }
+   QByteArray payload;
+   QDataStream out(&payload, QIODevice::WriteOnly);
+   out << (quint32)index;
+   out << (quint32)objects.size();
+   foreach (Object const * const object, objects) {
+      dirtyRanges.remove(object->getID());
+      object->save(out);
+   }
+   writeRecord(ADDOBJECTS, payload);
+}
+
+/** Pending box changes of the objects are dropped.
+  */
+void Journal::objectsDeleted(QList<int> const & ids) {
+   if (!file.isOpen()) {
+      return;
+   }
+   QByteArray payload;
+   QDataStream out(&payload, QIODevice::WriteOnly);
+   out << (quint32)ids.size();
+   foreach (int id, ids) {
+      dirtyRanges.remove(id);
+      out << (quint32)id;
+   }
+   writeRecord(DELETEOBJECTS, payload);
+}
+
+/** A journal is only kept if it belongs to the current state of the BTD file,
+  * else or if \a truncate is set a new one gets started. Incomplete records at
+  * the end of a kept journal, left by a crash while writing, get cut off.
+  * @note The BTD file has to be written and closed before.
+  */
+bool Journal::open(QString const & btdFilename, bool truncate) {
+   close();
+   QFileInfo btdInfo(btdFilename);
+   if (!btdInfo.exists()) {
+      return false;
+   }
+   file.setFileName(journalFilename(btdFilename));
+
+   qint64 validSize = -1;
+   if (!truncate && file.open(QIODevice::ReadOnly)) {
+      QDataStream in(&file);
+      if (readHeader(in, btdFilename)) {
+         validSize = file.pos();
+         quint8 type;
+         QByteArray payload;
+         while (readRecord(in, type, payload)) {
+            validSize = file.pos();
+         }
+      }
+      file.close();
+   }
+
+   if (validSize >= 0) {
+      if (!file.resize(validSize) || !file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+         return false;
+      }
+   }
+   else {
+      if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+         return false;
+      }
+      QDataStream out(&file);
+      out << (quint8)'B';
+      out << (quint8)'T';
+      out << (quint8)'J';
+      out << (quint8)1;
+      out << (qint64)btdInfo.size();
+      out << btdInfo.lastModified();
+      syncFile(file);
+   }
+   compactionSize = qMax(minimumCompactionSize, btdInfo.size()/2);
+   return true;
+}
+
+/** The header consists of the magic number, the version and the size and
+  * modification time of the BTD file at the time the journal was started.
+  */
+bool Journal::readHeader(QDataStream & in, QString const & btdFilename) {
+   quint8 magic[4];
+   for (int i=0; i<4; ++i) {
+      in >> magic[i];
+   }
+   if (magic[0] != (quint8)'B' || magic[1] != (quint8)'T' || magic[2] != (quint8)'J' || magic[3] != (quint8)1) {
+      return false;
+   }
+   qint64 size;
+   QDateTime lastModified;
+   in >> size;
+   in >> lastModified;
+   QFileInfo btdInfo(btdFilename);
+   return in.status() == QDataStream::Ok && size == btdInfo.size() && lastModified == btdInfo.lastModified();
+}
+
+/** Every record consists of its type and its payload as a QByteArray, so a
+  * record cut off by a crash can be recognized.
+  */
+bool Journal::readRecord(QDataStream & in, quint8 & type, QByteArray & payload) {
+   in >> type;
+   in >> payload;
+   return in.status() == QDataStream::Ok;
+}
+
+void Journal::sorted(bool byFramenumber) {
+   writeRecord(byFramenumber ? SORTBYFN : SORTBYID, QByteArray());
+}
+
+void Journal::videoChanged(QString const & filename) {
+   QByteArray payload;
+   QDataStream out(&payload, QIODevice::WriteOnly);
+   out << filename;
+   writeRecord(VIDEO, payload);
+}
+
+/** The pending box changes get written first to keep the order of the changes.
+  * If the journal is not open nothing happens.
+  */
+void Journal::writeRecord(quint8 type, QByteArray const & payload) {
+   if (!file.isOpen()) {
+      return;
+   }
+   writeDirtyRanges();
+   QDataStream out(&file);
+   out << type;
+   out << payload;
+   if (!flushTimer->isActive()) {
+      flushTimer->start();
+   }
+}
+
+/** Each record holds the current boxes of the object within the changed range,
+  * which replace the boxes within that range on replay.
+  */
+void Journal::writeDirtyRanges() {
+   const QHash<int, QPair<int, int> > ranges = dirtyRanges;
+   dirtyRanges.clear();
+   QDataStream out(&file);
+   for (QHash<int, QPair<int, int> >::const_iterator i=ranges.constBegin(); i!=ranges.constEnd(); ++i) {
+      Object const * const object = data->getObject(i.key());
+      if (!object) {
+         continue;
+      }
+      const QList<BBox> bboxes = object->getBBoxesInRange(i.value().first, i.value().second);
+      QByteArray payload;
+      QDataStream record(&payload, QIODevice::WriteOnly);
+      record << (quint32)i.key();
+      record << (qint32)i.value().first;
+      record << (qint32)i.value().second;
+      record << (quint32)bboxes.size();
+      foreach (BBox const & bbox, bboxes) {
+         record << (quint8)bbox.type;
+         record << (quint32)bbox.framenumber;
+         record << bbox.rect;
+      }
+      out << (quint8)BBOXES;
+      out << payload;
+   }
+}
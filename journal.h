@@ -0,0 +1,101 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtCore/QPair>
+
+class DataWidget;
+class Object;
+class QDataStream;
+class QTimer;
+
+/// Append-only log of the changes made to the data of a BTD file.
+/** Every change gets appended as a record to a journal file next to the BTD
+  * file, so autosaving costs time proportional to the changes instead of the
+  * size of the data. Box changes are collected per object and written along
+  * with the next structural change or when the #flushTimer fires, so drags and
+  * bulk edits result in a single record per object.
+  * The journal starts with the size and modification time of the BTD file it
+  * belongs to, so on opening the BTD file the records of a matching journal get
+  * replayed to recover the changes made since the last save. Once the journal
+  * outgrows half of the BTD file compactionNeeded() gets emitted, so the data
+  * can be saved and the journal restarted.
+  */
+class Journal : public QObject {
+
+   Q_OBJECT
+
+public:
+   /// The types of the records.
+   enum RecordType {
+      CLEAR = 1,      ///< All categories got deleted
+      ADDCATEGORY,    ///< A category got appended (name)
+      RENAMECATEGORY, ///< A category got renamed (index, name)
+      DELETECATEGORY, ///< A category got deleted (index)
+      SORTBYID,       ///< All categories got sorted by ID
+      SORTBYFN,       ///< All categories got sorted by framenumber
+      ADDOBJECTS,     ///< Objects got appended to a category (index, count, objects in the BTD format)
+      DELETEOBJECTS,  ///< Objects got deleted (count, IDs)
+      BBOXES,         ///< The boxes of an object within a range of frames got replaced (ID, first, last, count, boxes)
+      VIDEO           ///< The associated video file changed (filename)
+   };
+
+   /// Creates a closed journal for the data of \a data.
+   explicit Journal(DataWidget * data);
+   /// Writes all pending records.
+   ~Journal();
+   /// Starts journaling changes to the data saved in \a btdFilename.
+   bool open(QString const & btdFilename, bool truncate = false);
+   /// Writes all pending records and closes the journal file.
+   void close();
+   /// Returns true if changes get journaled.
+   bool isOpen() const;
+   /// Records that a category with the given \a name got appended.
+   void categoryAdded(QString const & name);
+   /// Records that the category at \a index got renamed to \a name.
+   void categoryRenamed(int index, QString const & name);
+   /// Records that the category at \a index got deleted.
+   void categoryDeleted(int index);
+   /// Records that all categories got sorted.
+   void sorted(bool byFramenumber);
+   /// Records that the \a objects got appended to the category at \a index.
+   void objectsAdded(int index, QList<Object *> const & objects);
+   /// Records that the objects with the given \a ids got deleted.
+   void objectsDeleted(QList<int> const & ids);
+   /// Records that the associated video file changed to \a filename.
+   void videoChanged(QString const & filename);
+   /// Returns the filename of the journal belonging to \a btdFilename.
+   static QString journalFilename(QString const & btdFilename);
+   /// Reads the header from \a in and returns true if it matches \a btdFilename.
+   static bool readHeader(QDataStream & in, QString const & btdFilename);
+   /// Reads the next record from \a in and returns false if there is no complete one.
+   static bool readRecord(QDataStream & in, quint8 & type, QByteArray & payload);
+
+signals:
+   /// Gets emitted when the journal grew large enough to be merged into the BTD file.
+   void compactionNeeded();
+
+private:
+   static const qint64 minimumCompactionSize = 1<<20; ///< Journal size below which no compaction is requested
+   DataWidget * data;                                  ///< The widget holding the journaled data
+   QFile file;                                         ///< The journal file
+   qint64 compactionSize;                              ///< Journal size from which on compaction is requested
+   QHash<int, QPair<int, int> > dirtyRanges;           ///< Changed frames by object ID not written yet
+   QTimer * flushTimer;                                ///< Timer to write the pending records
+
+   /// Appends a record of the given \a type with the \a payload.
+   void writeRecord(quint8 type, QByteArray const & payload);
+   /// Appends a record for each of the #dirtyRanges.
+   void writeDirtyRanges();
+
+private slots:
+   /// Collects the changed frames of the object with the given \a objectID.
+   void objectDataChanged(int objectID, int firstFrame, int lastFrame);
+   /// Writes all pending records to the disk.
+   void flush();
+};
+
+#endif // JOURNAL_H
@@ -0,0 +1,379 @@
+#include "keyframeindex.h"
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QList>
+#include <QtCore/QPair>
+#include <QtCore/QtAlgorithms>
+#include <QtCore/QtEndian>
+
+/// Returns the fourcc \a s as read from a little endian (RIFF) file.
+inline quint32 riffFourcc(char const * s) {
+   return qFromLittleEndian<quint32>(reinterpret_cast<uchar const *>(s));
+}
+
+/// Returns the fourcc \a s as read from a big endian (MP4) file.
+inline quint32 mp4Fourcc(char const * s) {
+   return qFromBigEndian<quint32>(reinterpret_cast<uchar const *>(s));
+}
+
+/// Consecutive samples sharing the same value in the stts or ctts box of a MP4 file.
+struct Mp4SampleRun {
+   quint32 count; ///< Number of samples
+   quint32 value; ///< Duration (stts) or composition offset (ctts) of each sample
+};
+
+/// The relevant parts of a track of a MP4 file.
+struct Mp4Track {
+   bool video;                      ///< Indicates whether the track holds video data
+   bool hasSyncSamples;             ///< Indicates whether the track has a stss box
+   QVector<int> samples;            ///< The zero based numbers of the sync samples in decoding order
+   QVector<Mp4SampleRun> durations; ///< The durations of the samples from the stts box
+   QVector<Mp4SampleRun> offsets;   ///< The composition offsets of the samples from the ctts box
+   /// Default c'tor.
+   Mp4Track() : video(false), hasSyncSamples(false) {}
+};
+
+/** The \a file has to be positioned at the start of the box content, which
+  * ends at \a boxEnd. Entries beyond the end of the box are ignored.
+  */
+static QVector<Mp4SampleRun> readMp4SampleRuns(QFile & file, qint64 boxEnd) {
+   QVector<Mp4SampleRun> runs;
+   // version/flags, entry_count, {sample_count, sample_delta or sample_offset}[entry_count]
+   const QByteArray data = file.read(8);
+   if (data.size() < 8) {
+      return runs;
+   }
+   const qint64 count = qMin<qint64>(qFromBigEndian<quint32>(reinterpret_cast<uchar const *>(data.constData()+4)),
+                                     (boxEnd-file.pos())/8);
+   const QByteArray entries = file.read(count*8);
+   uchar const * const entry = reinterpret_cast<uchar const *>(entries.constData());
+   runs.resize(entries.size()/8);
+   for (int i=0; i<runs.size(); ++i) {
+      runs[i].count = qFromBigEndian<quint32>(entry+8*i);
+      runs[i].value = qFromBigEndian<quint32>(entry+8*i+4);
+   }
+   return runs;
+}
+
+/** The samples of a track are stored in decoding order, but frames are numbered
+  * in presentation order, which differs as soon as there are B-frames. The
+  * presentation time of a sample is the sum of the durations of the preceding
+  * samples plus its composition offset, samples with equal times keep their
+  * decoding order. Returns the presentation position of each sample, or an
+  * empty vector if the \a track has implausibly many samples.
+  */
+static QVector<int> presentationOrder(Mp4Track const & track) {
+   // 2^24 frames are more than three days at 60 fps
+   const qint64 maxSamples = 1 << 24;
+   qint64 sampleCount = 0;
+   foreach (Mp4SampleRun const & run, track.durations) {
+      sampleCount += run.count;
+   }
+   if (sampleCount > maxSamples) {
+      return QVector<int>();
+   }
+
+   QVector<QPair<qint64, int> > times;
+   times.reserve(sampleCount);
+   qint64 time = 0;
+   int offsetRun = 0;
+   quint32 offsetsLeft = track.offsets.isEmpty() ? 0 : track.offsets.first().count;
+   foreach (Mp4SampleRun const & run, track.durations) {
+      for (quint32 i=0; i<run.count; ++i) {
+         while (offsetsLeft == 0 && offsetRun+1 < track.offsets.size()) {
+            offsetsLeft = track.offsets.at(++offsetRun).count;
+         }
+         qint64 offset = 0;
+         if (offsetsLeft > 0) {
+            // version 1 offsets are signed, version 0 offsets never exceed 2^31 in practice
+            offset = qint32(track.offsets.at(offsetRun).value);
+            --offsetsLeft;
+         }
+         times << qMakePair(time+offset, times.size());
+         time += run.value;
+      }
+   }
+   qSort(times);
+
+   QVector<int> order(times.size());
+   for (int i=0; i<times.size(); ++i) {
+      order[times.at(i).second] = i;
+   }
+   return order;
+}
+
+/** The boxes from the current position of the \a file up to \a end get read
+  * recursively, each finished trak box gets appended to \a tracks. Boxes
+  * belonging to a track are stored in \a track.
+  */
+static void readMp4Boxes(QFile & file, qint64 end, Mp4Track * track, QList<Mp4Track> & tracks) {
+   while (file.pos()+8 <= end) {
+      const qint64 start = file.pos();
+      const QByteArray header = file.read(8);
+      if (header.size() < 8) {
+         return;
+      }
+      quint64 size = qFromBigEndian<quint32>(reinterpret_cast<uchar const *>(header.constData()));
+      const quint32 type = mp4Fourcc(header.constData()+4);
+      if (size == 1) {
+         const QByteArray largeSize = file.read(8);
+         if (largeSize.size() < 8) {
+            return;
+         }
+         size = qFromBigEndian<quint64>(reinterpret_cast<uchar const *>(largeSize.constData()));
+      }
+      else if (size == 0) {
+         // the box extends to the end of its parent
+         size = end-start;
+      }
+      const qint64 boxEnd = start+size;
+      if (size < 8 || boxEnd > end) {
+         return;
+      }
+
+      if (type == mp4Fourcc("moov") || type == mp4Fourcc("mdia") ||
+          type == mp4Fourcc("minf") || type == mp4Fourcc("stbl")) {
+         readMp4Boxes(file, boxEnd, track, tracks);
+      }
+      else if (type == mp4Fourcc("trak")) {
+         Mp4Track newTrack;
+         readMp4Boxes(file, boxEnd, &newTrack, tracks);
+         tracks << newTrack;
+      }
+      else if (track && type == mp4Fourcc("hdlr")) {
+         // version/flags, pre_defined, handler_type
+         const QByteArray data = file.read(12);
+         track->video = data.size() == 12 && mp4Fourcc(data.constData()+8) == mp4Fourcc("vide");
+      }
+      else if (track && type == mp4Fourcc("stss")) {
+         // version/flags, entry_count, sample_number[entry_count]
+         const QByteArray data = file.read(8);
+         if (data.size() == 8) {
+            const qint64 count = qMin<qint64>(qFromBigEndian<quint32>(reinterpret_cast<uchar const *>(data.constData()+4)),
+                                              (boxEnd-file.pos())/4);
+            const QByteArray entries = file.read(count*4);
+            uchar const * const entry = reinterpret_cast<uchar const *>(entries.constData());
+            track->samples.clear();
+            track->samples.reserve(entries.size()/4);
+            for (int i=0; i<entries.size()/4; ++i) {
+               // sample numbers start at 1
+               track->samples << int(qFromBigEndian<quint32>(entry+4*i))-1;
+            }
+            track->hasSyncSamples = true;
+         }
+      }
+      else if (track && type == mp4Fourcc("stts")) {
+         track->durations = readMp4SampleRuns(file, boxEnd);
+      }
+      else if (track && type == mp4Fourcc("ctts")) {
+         track->offsets = readMp4SampleRuns(file, boxEnd);
+      }
+      file.seek(boxEnd);
+   }
+}
+
+KeyframeIndex::KeyframeIndex() :
+   valid(false),
+   intraOnly(false),
+   videoSize(0)
+{
+}
+
+/** The type of the container is determined by its header, unsupported
+  * containers result in an invalid index.
+  */
+bool KeyframeIndex::build(QString const & videoFilename) {
+   clear();
+   QFile file(videoFilename);
+   if (!file.open(QIODevice::ReadOnly)) {
+      return false;
+   }
+   const QByteArray header = file.read(12);
+   if (header.size() < 12) {
+      return false;
+   }
+
+   bool ok = false;
+   if (header.startsWith("RIFF") && header.mid(8, 4) == "AVI ") {
+      ok = parseAvi(file);
+   }
+   else if (header.mid(4, 4) == "ftyp" || header.mid(4, 4) == "moov" ||
+            header.mid(4, 4) == "mdat" || header.mid(4, 4) == "wide") {
+      file.seek(0);
+      ok = parseMp4(file);
+   }
+   if (!ok) {
+      clear();
+      return false;
+   }
+
+   QFileInfo info(videoFilename);
+   videoSize = info.size();
+   videoModified = info.lastModified();
+   valid = true;
+   return true;
+}
+
+void KeyframeIndex::clear() {
+   valid = false;
+   intraOnly = false;
+   keyframes.clear();
+   videoSize = 0;
+   videoModified = QDateTime();
+}
+
+bool KeyframeIndex::isValid() const {
+   return valid;
+}
+
+/** If every frame is a keyframe, \a frame itself is returned. If the index is
+  * invalid, -1 is returned.
+  */
+int KeyframeIndex::keyframeBefore(int frame) const {
+   if (!valid) {
+      return -1;
+   }
+   if (intraOnly) {
+      return frame;
+   }
+   QVector<int>::const_iterator it = qUpperBound(keyframes.constBegin(), keyframes.constEnd(), frame);
+   if (it == keyframes.constBegin()) {
+      // the first frame is always decodable
+      return 0;
+   }
+   return *(it-1);
+}
+
+/** If the index file doesn't exist, is broken or belongs to a different or
+  * changed video file, false is returned and the index stays invalid.
+  * Version 1 files may hold MP4 keyframes in decoding order, so they get
+  * rebuilt, too.
+  */
+bool KeyframeIndex::load(QString const & indexFilename, QString const & videoFilename) {
+   clear();
+   QFile file(indexFilename);
+   if (!file.open(QIODevice::ReadOnly)) {
+      return false;
+   }
+   QDataStream in(&file);
+   quint8 k, f, i, version;
+   in >> k >> f >> i >> version;
+   if (k != (quint8)'K' || f != (quint8)'F' || i != (quint8)'I' || version != (quint8)2) {
+      return false;
+   }
+   in >> videoSize >> videoModified >> intraOnly >> keyframes;
+   QFileInfo info(videoFilename);
+   if (in.status() != QDataStream::Ok ||
+       videoSize != info.size() || videoModified != info.lastModified()) {
+      clear();
+      return false;
+   }
+   valid = true;
+   return true;
+}
+
+/** Only the video stream's chunks (\c \#\#dc and \c \#\#db) are counted as
+  * frames, a set AVIIF_KEYFRAME flag marks a keyframe. OpenDML files without a
+  * idx1 chunk are not supported.
+  */
+bool KeyframeIndex::parseAvi(QFile & file) {
+   const quint32 keyframeFlag = 0x10;
+   int streamCount = 0;
+   int videoStream = -1;
+   while (!file.atEnd()) {
+      const QByteArray header = file.read(8);
+      if (header.size() < 8) {
+         return false;
+      }
+      const quint32 fourcc = riffFourcc(header.constData());
+      const quint32 size = riffFourcc(header.constData()+4);
+      // chunks are padded to an even size
+      const qint64 next = file.pos()+size+(size&1);
+
+      if (fourcc == riffFourcc("LIST")) {
+         const QByteArray listType = file.read(4);
+         if (listType == "hdrl" || listType == "strl") {
+            // descend into the list, its chunks follow directly
+            continue;
+         }
+      }
+      else if (fourcc == riffFourcc("strh")) {
+         const QByteArray type = file.read(4);
+         if (type == "vids" && videoStream < 0) {
+            videoStream = streamCount;
+         }
+         ++streamCount;
+      }
+      else if (fourcc == riffFourcc("idx1")) {
+         if (videoStream < 0 || videoStream > 99) {
+            return false;
+         }
+         const char streamId[2] = {char('0'+videoStream/10), char('0'+videoStream%10)};
+         const QByteArray entries = file.read(size);
+         char const * const data = entries.constData();
+         int frame = 0;
+         // each entry consists of ckid, flags, offset and size
+         for (int i=0; i+16<=entries.size(); i+=16) {
+            if (data[i] != streamId[0] || data[i+1] != streamId[1] ||
+                data[i+2] != 'd' || (data[i+3] != 'c' && data[i+3] != 'b')) {
+               continue;
+            }
+            if (riffFourcc(data+i+4) & keyframeFlag) {
+               keyframes << frame;
+            }
+            ++frame;
+         }
+         return !keyframes.isEmpty();
+      }
+      file.seek(next);
+   }
+   return false;
+}
+
+/** The first video track is used. If it has no stss box, every frame is a
+  * keyframe. If it has a ctts box, the sync samples get mapped from decoding
+  * to presentation order, which is the order the frames are numbered in.
+  */
+bool KeyframeIndex::parseMp4(QFile & file) {
+   QList<Mp4Track> tracks;
+   readMp4Boxes(file, file.size(), NULL, tracks);
+   foreach (Mp4Track const & track, tracks) {
+      if (track.video) {
+         intraOnly = !track.hasSyncSamples;
+         keyframes = track.samples;
+         if (!intraOnly && !track.offsets.isEmpty()) {
+            const QVector<int> order = presentationOrder(track);
+            for (int i=0; i<keyframes.size(); ++i) {
+               if (keyframes.at(i) < 0 || keyframes.at(i) >= order.size()) {
+                  return false;
+               }
+               keyframes[i] = order.at(keyframes.at(i));
+            }
+         }
+         qSort(keyframes);
+         return intraOnly || !keyframes.isEmpty();
+      }
+   }
+   return false;
+}
+
+/** The file starts with the bytes 'K', 'F', 'I' and the version, followed by
+  * the size and modification time of the video and the keyframes.
+  */
+bool KeyframeIndex::save(QString const & indexFilename) const {
+   if (!valid) {
+      return false;
+   }
+   QFile file(indexFilename);
+   if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+      return false;
+   }
+   QDataStream out(&file);
+   out << (quint8)'K';
+   out << (quint8)'F';
+   out << (quint8)'I';
+   out << (quint8)2;
+   out << videoSize << videoModified << intraOnly << keyframes;
+   return out.status() == QDataStream::Ok;
+}
@@ -0,0 +1,51 @@
+#ifndef KEYFRAMEINDEX_H
+#define KEYFRAMEINDEX_H
+
+#include <QtCore/QDateTime>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+class QFile;
+
+/// Index of the keyframe positions of a video file.
+/** Seeking in a video is only cheap if the decoder can start at a keyframe, so
+  * the FrameDecoder uses this index to jump to the nearest preceding keyframe
+  * and decodes forward from there. The index is built by reading the container
+  * directly, which is supported for AVI files (idx1 chunk) and MP4/MOV files
+  * (stss box of the first video track, mapped to presentation order through its
+  * stts and ctts boxes). As building it requires to read parts
+  * of the whole video, it gets persisted to a small file and is only valid as
+  * long as the video's size and modification time don't change.
+  */
+class KeyframeIndex {
+
+public:
+   /// Default c'tor, creates an invalid index.
+   KeyframeIndex();
+   /// Builds the index from the video file with the given \a videoFilename.
+   bool build(QString const & videoFilename);
+   /// Loads the index from \a indexFilename if it still matches the video file \a videoFilename.
+   bool load(QString const & indexFilename, QString const & videoFilename);
+   /// Saves the index to \a indexFilename.
+   bool save(QString const & indexFilename) const;
+   /// Returns whether the index holds usable data.
+   bool isValid() const;
+   /// Invalidates the index.
+   void clear();
+   /// Returns the number of the last keyframe not after \a frame.
+   int keyframeBefore(int frame) const;
+
+private:
+   bool valid;              ///< Indicates whether the index holds usable data
+   bool intraOnly;          ///< Indicates that every frame is a keyframe
+   QVector<int> keyframes;  ///< The sorted numbers of the keyframes
+   qint64 videoSize;        ///< Size of the indexed video file in bytes
+   QDateTime videoModified; ///< Last modification of the indexed video file
+
+   /// Reads the keyframes from the idx1 chunk of an AVI \a file.
+   bool parseAvi(QFile & file);
+   /// Reads the keyframes from the stss, stts and ctts boxes of a MP4 \a file.
+   bool parseMp4(QFile & file);
+};
+
+#endif // KEYFRAMEINDEX_H
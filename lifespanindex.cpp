@@ -0,0 +1,81 @@
+#include "lifespanindex.h"
+#include <QtCore/QtAlgorithms>
+
+LifespanIndex::LifespanIndex() {
+}
+
+/** Spans with a first framenumber greater than their last one (e.g. of empty
+  * objects) are left out.
+  */
+void LifespanIndex::build(QVector<Lifespan> const & lifespans) {
+   clear();
+   spans.reserve(lifespans.size());
+   for (int row=0; row<lifespans.size(); ++row) {
+      if (lifespans.at(row).first <= lifespans.at(row).second) {
+         Span span;
+         span.first = lifespans.at(row).first;
+         span.last = lifespans.at(row).second;
+         span.row = row;
+         spans << span;
+      }
+   }
+   if (spans.isEmpty()) {
+      return;
+   }
+   qStableSort(spans.begin(), spans.end(), lessThanByFirst);
+   tree.resize(4*spans.size());
+   buildNode(0, 0, spans.size());
+}
+
+/** Returns the maximum last framenumber of the node.
+  */
+int LifespanIndex::buildNode(int node, int begin, int end) {
+   if (end-begin == 1) {
+      tree[node] = spans.at(begin).last;
+   }
+   else {
+      const int middle = (begin+end)/2;
+      tree[node] = qMax(buildNode(2*node+1, begin, middle),
+                        buildNode(2*node+2, middle, end));
+   }
+   return tree.at(node);
+}
+
+void LifespanIndex::clear() {
+   spans.clear();
+   tree.clear();
+}
+
+/** Since the spans are sorted by their first framenumber, a node can be skipped
+  * as soon as its first span starts after \a framenumber or all of its spans
+  * end before.
+  */
+void LifespanIndex::collect(int node, int begin, int end, int framenumber, QVector<int> & rows) const {
+   if (spans.at(begin).first > framenumber || tree.at(node) < framenumber) {
+      return;
+   }
+   if (end-begin == 1) {
+      rows << spans.at(begin).row;
+   }
+   else {
+      const int middle = (begin+end)/2;
+      collect(2*node+1, begin, middle, framenumber, rows);
+      collect(2*node+2, middle, end, framenumber, rows);
+   }
+}
+
+bool LifespanIndex::lessThanByFirst(Span const & span1, Span const & span2) {
+   return span1.first < span2.first;
+}
+
+/** The rows are sorted, so the order of the results matches the order of the
+  * objects.
+  */
+QVector<int> LifespanIndex::rowsAt(int framenumber) const {
+   QVector<int> rows;
+   if (!spans.isEmpty()) {
+      collect(0, 0, spans.size(), framenumber, rows);
+      qSort(rows);
+   }
+   return rows;
+}
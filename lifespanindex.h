@@ -0,0 +1,49 @@
+#ifndef LIFESPANINDEX_H
+#define LIFESPANINDEX_H
+
+#include <QtCore/QPair>
+#include <QtCore/QVector>
+
+/// Interval tree over the lifespans of the objects of a Category.
+/** The lifespan of an object reaches from the framenumber of its first to the
+  * one of its last bounding box. The spans are sorted by their first frame and
+  * a balanced binary tree over them stores the maximum last frame of each
+  * subtree, so a query only descends into subtrees containing spans alive at
+  * the requested frame. This makes a query O(log n + m log n) for m results
+  * instead of visiting all n objects.
+  */
+class LifespanIndex {
+
+public:
+   /// A lifespan as first and last framenumber
+   typedef QPair<int, int> Lifespan;
+
+   /// Creates an empty index.
+   LifespanIndex();
+   /// Builds the index from the \a lifespans of the objects, where the index of a span is its row.
+   void build(QVector<Lifespan> const & lifespans);
+   /// Returns the rows of all objects alive at \a framenumber in ascending order.
+   QVector<int> rowsAt(int framenumber) const;
+   /// Removes all spans.
+   void clear();
+
+private:
+   /// A lifespan together with the row of its object
+   struct Span {
+      int first; ///< The first framenumber
+      int last;  ///< The last framenumber
+      int row;   ///< The row of the object
+   };
+
+   QVector<Span> spans; ///< The spans sorted by their first framenumber
+   QVector<int> tree;   ///< Maximum last framenumber of each node, the root is node 0
+
+   /// Fills the \a node covering the spans from \a begin to \a end (exclusive).
+   int buildNode(int node, int begin, int end);
+   /// Appends the rows of the spans of \a node alive at \a framenumber to \a rows.
+   void collect(int node, int begin, int end, int framenumber, QVector<int> & rows) const;
+   /// Orders the spans by their first framenumber.
+   static bool lessThanByFirst(Span const & span1, Span const & span2);
+};
+
+#endif // LIFESPANINDEX_H
@@ -3,6 +3,7 @@
 #include "videowidget.h"
 #include "datawidget.h"
 #include "scrollarea.h"
+#include "timelineview.h"
 #include "julia.h"
 
 /**
@@ -490,10 +491,20 @@ void MainWindow::createMenus() {
    helpMenu->addAction(aboutAction);
 }
 
-/** Actually the possible status bar isn't used, but if you plan to do so here is
-  * the place to set it up.
+/** The status bar shows the state of the video pipeline, e.g. how many frames
+  * the decoder is ahead, how well the frame cache performs and how much memory
+  * the frame texture needs.
   */
 void MainWindow::createStatusBar() {
+   decoderLabel = new QLabel();
+   statusBar()->addPermanentWidget(decoderLabel);
+   connect(videoWidget, SIGNAL(decoderStatsChanged(QString)), decoderLabel, SLOT(setText(QString)));
+   cacheLabel = new QLabel();
+   statusBar()->addPermanentWidget(cacheLabel);
+   connect(videoWidget, SIGNAL(cacheStatsChanged(QString)), cacheLabel, SLOT(setText(QString)));
+   textureLabel = new QLabel();
+   statusBar()->addPermanentWidget(textureLabel);
+   connect(videoWidget, SIGNAL(textureStatsChanged(QString)), textureLabel, SLOT(setText(QString)));
 }
 
 void MainWindow::createToolbars() {
@@ -576,7 +587,7 @@ QLayout * MainWindow::createZoomLayout() {
   * currently useless) actions are removed.
   */
 void MainWindow::dataContextMenu(QPoint const & pos) {
-   QTableView * tableView = static_cast<QTableView *>(dataWidget->currentWidget());
+   TimelineView * tableView = static_cast<TimelineView *>(dataWidget->currentWidget());
    QHeaderView * headerView = tableView->verticalHeader();
 
    if (!tableView->underMouse()) {
@@ -663,6 +674,7 @@ void MainWindow::initGUI() {
    connect(dataWidget, SIGNAL(requestVideo(QString)), videoWidget, SLOT(openRequest(QString)));
 
    connect(dataWidget, SIGNAL(dataDecreased()), videoWidget, SLOT(updateData()));
+   connect(dataWidget, SIGNAL(dataModified()), videoWidget, SLOT(invalidateData()));
 
    connect(videoWidget, SIGNAL(zoomChanged(float)), this, SLOT(zoomChanged(float)));
 
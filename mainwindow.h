@@ -68,6 +68,9 @@ private:
    QLabel * seekLabel;              ///< The label shows the current framenumber
    QLabel * zoomLabel;              ///< The label shows the current zoom factor
    QLabel * timeLabel;              ///< The label shows the elapsed time
+   QLabel * decoderLabel;           ///< The label shows the state of the frame decoder
+   QLabel * cacheLabel;             ///< The label shows the state of the frame cache
+   QLabel * textureLabel;           ///< The label shows the memory used by the frame texture
    QIcon newSingleBoxIcon;          ///< Icon for a the new single box action
    QIcon newKeyBoxIcon;             ///< Icon for a the new key box action
    QIcon convertSingleBoxIcon;      ///< Icon for a the convert to single box action
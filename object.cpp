@@ -1,24 +1,105 @@
 #include "object.h"
 #include "idcounter.h"
+#include "objectstore.h"
 #include <QtCore/QDataStream>
+#include <QtCore/QXmlStreamReader>
+#include <QtCore/QXmlStreamWriter>
+
+/// Appends \a value to \a data with 7 bits per byte, the high bit marks following bytes.
+inline void appendVarint(QByteArray & data, quint32 value) {
+   while (value >= 0x80) {
+      data.append(char(value | 0x80));
+      value >>= 7;
+   }
+   data.append(char(value));
+}
+
+/// Reads a value written by appendVarint() at \a pos, which gets advanced but never beyond \a end.
+inline quint32 readVarint(char const *& pos, char const * end) {
+   quint32 value = 0;
+   for (int shift=0; pos<end && shift<35; shift+=7) {
+      const quint8 byte = *pos++;
+      value |= quint32(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+         break;
+      }
+   }
+   return value;
+}
+
+/// Maps signed to unsigned values so small differences of both signs get small.
+inline quint32 zigzag(qint32 value) {
+   return (quint32(value) << 1) ^ quint32(value >> 31);
+}
+
+/// Reverts zigzag().
+inline qint32 unzigzag(quint32 value) {
+   return qint32(value >> 1) ^ -qint32(value & 1);
+}
+
+/// Returns the x, y, width or height of the \a rect for the \a column 0 to 3.
+inline int rectColumn(QRect const & rect, int column) {
+   switch (column) {
+   case 0:
+      return rect.x();
+   case 1:
+      return rect.y();
+   case 2:
+      return rect.width();
+   default:
+      return rect.height();
+   }
+}
+
+/// Writes a data:bbox node with the \a framespan and the geometry of the \a rect.
+inline void writeViperBBox(QXmlStreamWriter & writer, QString const & framespan, QRect const & rect) {
+   writer.writeEmptyElement("data:bbox");
+   writer.writeAttribute("framespan", framespan);
+   writer.writeAttribute("x", QString::number(rect.x()));
+   writer.writeAttribute("y", QString::number(rect.y()));
+   writer.writeAttribute("width", QString::number(rect.width()));
+   writer.writeAttribute("height", QString::number(rect.height()));
+}
+
+/// Appends a run of the \a type from \a first to \a last to the \a runs, merging it with the last one if possible.
+inline void appendRun(QVector<BBoxRun> & runs, BBox::Type type, int first, int last) {
+   if (!runs.isEmpty() && runs.last().type==type && runs.last().last+1==first) {
+      runs.last().last = last;
+   }
+   else {
+      BBoxRun run;
+      run.first = first;
+      run.last = last;
+      run.type = type;
+      runs << run;
+   }
+}
+
+/// Decodes the boxes on the first access, see Object::decode().
+inline void Object::load() const {
+   if (encoded) {
+      decode();
+   }
+}
 
 /** The object gets assigned a unique ID so it can be identified.
   */
 Object::Object() :
-   QObject(), id(idCounter->getID())
+   id(idCounter->getID()), segmentKey(objectStore->newSegmentKey()), runsValid(false), encoded(false), blockChecksum(0), blockFirstFrame(0), blockLastFrame(-1)
 {
 }
 
 /** The stream data is interpreted as an object in the BTD file format.
   */
 Object::Object(QDataStream & in) :
-   QObject()
+   segmentKey(objectStore->newSegmentKey()), runsValid(false), encoded(false), blockChecksum(0), blockFirstFrame(0), blockLastFrame(-1)
 {
    quint32 readID;
    in >> readID;
    id = readID;
    quint32 size;
    in >> size;
+   bboxes.reserve(size);
    BBox bbox;
    quint8 type;
    quint32 framenumber;
@@ -29,79 +110,217 @@ Object::Object(QDataStream & in) :
       bbox.framenumber = framenumber;
       in >> bbox.rect;
       bbox.objectID = id;
-      addBBox(bbox);
+      insertBBox(bbox);
    }
 }
 
 /** The ctor parses the viper object node for bounding boxes and adds them as
   * BBox instances to the internal list. Boxes that last for more than one frame
   * get converted to a BBox::SINGLE and a BBox::KEYBOX typed BBox marking the
-  * beginning and the end of the box from the viper file.
+  * beginning and the end of the box from the viper file. Only the data:bbox
+  * nodes of the first attribute node are read, the \a reader is left at the end
+  * of the object node.
   * @note The object gets assigned a new unique ID, whereas the ID from the
   * viper file gets omitted to keep the integrity of the internal ID generator.
-  * @sa <a href="http://qt-project.org/doc/qt-4.8/qdomelement.html">QDomElement</a>
-  *     toViperNode(QDomDocument & doc, QString const & catName) const
+  * @sa <a href="http://qt-project.org/doc/qt-4.8/qxmlstreamreader.html">QXmlStreamReader</a>
+  *     writeViperNode(QXmlStreamWriter & writer, QString const & catName) const
   */
-Object::Object(QDomElement const & objectElem) :
-   QObject(), id(idCounter->getID())
+Object::Object(QXmlStreamReader & reader) :
+   id(idCounter->getID()), segmentKey(objectStore->newSegmentKey()), runsValid(false), encoded(false), blockChecksum(0), blockFirstFrame(0), blockLastFrame(-1)
 {
-   QDomElement attributeElem = objectElem.firstChildElement(QString("attribute"));
-   if (!attributeElem.isNull()) {
-      QDomElement bboxElem = attributeElem.firstChildElement(QString("data:bbox"));
-      int firstFrame, lastFrame;
-      QRect rect;
-      while (!bboxElem.isNull()) {
-         // viper has 1-based framenumbers, default is 0-based!
-         firstFrame = bboxElem.attribute("framespan").section(':', 0, 0).toInt()-1;
-         lastFrame = bboxElem.attribute("framespan").section(':', 1, 1).toInt()-1;
-         rect = QRect(bboxElem.attribute("x").toInt(),
-                      bboxElem.attribute("y").toInt(),
-                      bboxElem.attribute("width").toInt(),
-                      bboxElem.attribute("height").toInt());
-         addBBox(BBox(firstFrame, rect, id, BBox::SINGLE));
-         if (lastFrame>firstFrame) {
-            addBBox(BBox(lastFrame, rect, id, BBox::KEYBOX));
+   bool attributeRead = false;
+   int firstFrame, lastFrame;
+   QRect rect;
+   while (reader.readNextStartElement()) {
+      if (!attributeRead && reader.qualifiedName() == QLatin1String("attribute")) {
+         attributeRead = true;
+         while (reader.readNextStartElement()) {
+            if (reader.qualifiedName() == QLatin1String("data:bbox")) {
+               const QXmlStreamAttributes attributes = reader.attributes();
+               const QString framespan = attributes.value("framespan").toString();
+               // viper has 1-based framenumbers, default is 0-based!
+               firstFrame = framespan.section(':', 0, 0).toInt()-1;
+               lastFrame = framespan.section(':', 1, 1).toInt()-1;
+               rect = QRect(attributes.value("x").toString().toInt(),
+                            attributes.value("y").toString().toInt(),
+                            attributes.value("width").toString().toInt(),
+                            attributes.value("height").toString().toInt());
+               insertBBox(BBox(firstFrame, rect, id, BBox::SINGLE));
+               if (lastFrame>firstFrame) {
+                  insertBBox(BBox(lastFrame, rect, id, BBox::KEYBOX));
+               }
+            }
+            reader.skipCurrentElement();
          }
-         bboxElem = bboxElem.nextSiblingElement(QString("data:bbox"));
+      }
+      else {
+         reader.skipCurrentElement();
       }
    }
 }
 
+/** Only the framenumbers of the first and the last box get stored, the \a block
+  * is neither copied nor decoded before the boxes get accessed.
+  * @sa void decode() const
+  */
+Object::Object(int id, QByteArray const & block, quint16 checksum, int firstFrame, int lastFrame) :
+   id(id), segmentKey(objectStore->newSegmentKey()), runsValid(false), block(block), encoded(true), blockChecksum(checksum), blockFirstFrame(firstFrame), blockLastFrame(lastFrame)
+{
+}
+
+/** Only the ObjectStore destroys objects, as it owns their memory.
+  */
+Object::~Object() {
+}
+
 /** The box gets inserted so that the list of boxes stays sorted by framenumber.
   * If  a box with the given framenumber already exists it will be replaced by
   * the new box.\n
+  * @sa void insertBBox(BBox const & bbox)
   */
 void Object::addBBox(BBox const & bbox) {
-   bboxes.insert(bbox.framenumber, bbox);
-   emit dataChanged(id, bbox.framenumber);
+   insertBBox(bbox);
+   invalidateInterpolation(bbox.framenumber);
+   notifyDataChanged(bbox.framenumber);
+}
+
+/** This is meant for building objects from files, instead of one signal per
+  * box only one signal covering all boxes is emitted.
+  * @sa void addBBox(BBox const & bbox)
+  */
+void Object::addBBoxes(QList<BBox> const & newBBoxes) {
+   if (newBBoxes.isEmpty()) {
+      return;
+   }
+   load();
+   bboxes.reserve(bboxes.size()+newBBoxes.size());
+   foreach (BBox const & bbox, newBBoxes) {
+      insertBBox(bbox);
+   }
+   // a new key drops all cached segments of the object at once
+   segmentKey = objectStore->newSegmentKey();
+   objectStore->notifyDataChanged(id, firstBBox().framenumber, lastBBox().framenumber);
+}
+
+/** The #block is decoded as written by toBlock() after its checksum got
+  * verified. A damaged block leaves the object empty, which gets reported to
+  * the ObjectStore. The block gets released afterwards.
+  */
+void Object::decode() const {
+   encoded = false;
+   if (qChecksum(block.constData(), block.size()) != blockChecksum) {
+      qWarning("Object %d is damaged, its bounding boxes got dropped.", id);
+      block.clear();
+      objectStore->notifyDamaged(id, blockFirstFrame, blockLastFrame);
+      return;
+   }
+
+   char const * pos = block.constData();
+   char const * const end = pos+block.size();
+   // every box takes at least five bytes
+   const int size = qMin<quint32>(readVarint(pos, end), block.size()/5);
+   bboxes.resize(size);
+
+   int framenumber = 0;
+   for (int i=0; i<size; ++i) {
+      framenumber += unzigzag(readVarint(pos, end));
+      bboxes[i].framenumber = framenumber;
+   }
+
+   const quint32 runCount = readVarint(pos, end);
+   int typed = 0;
+   for (quint32 run=0; run<runCount && pos<end; ++run) {
+      const quint8 type = *pos++;
+      const quint32 length = readVarint(pos, end);
+      for (quint32 j=0; j<length && typed<size; ++j) {
+         bboxes[typed++].type = type;
+      }
+   }
+
+   QVector<int> coordinates(4*size);
+   for (int column=0; column<4; ++column) {
+      int value = 0;
+      for (int i=0; i<size; ++i) {
+         value += unzigzag(readVarint(pos, end));
+         coordinates[4*i+column] = value;
+      }
+   }
+   for (int i=0; i<size; ++i) {
+      bboxes[i].rect = QRect(coordinates.at(4*i), coordinates.at(4*i+1), coordinates.at(4*i+2), coordinates.at(4*i+3));
+   }
+   block.clear();
+}
+
+/** The sorted boxes already form a run length encoding: every box is a run of
+  * its own type and the frames up to a key box form a run of virtual boxes.
+  * Adjacent runs of the same type get merged, so e.g. a track of consecutive
+  * single boxes becomes a single run. The runs only depend on the framenumbers
+  * and types of the boxes, so they stay valid until boxes get added or deleted.
+  */
+void Object::buildRuns() const {
+   load();
+   runs.clear();
+   for (int i=0; i<bboxes.size(); ++i) {
+      const int framenumber = bboxes.at(i).framenumber;
+      if (i>0 && bboxes.at(i).type==BBox::KEYBOX && framenumber>bboxes.at(i-1).framenumber+1) {
+         appendRun(runs, BBox::VIRTUAL, bboxes.at(i-1).framenumber+1, framenumber-1);
+      }
+      appendRun(runs, BBox::Type(bboxes.at(i).type), framenumber, framenumber);
+   }
+   runs.squeeze();
+   runsValid = true;
 }
 
 /** If no such box exists nothing happens.
   */
 void Object::deleteBBoxAt(int framenumber) {
-   bboxes.remove(framenumber);
+   const int i = lowerBound(framenumber);
+   if (i<bboxes.size() && bboxes.at(i).framenumber==framenumber) {
+      bboxes.remove(i);
+      runsValid = false;
+      invalidateInterpolation(framenumber);
+      notifyDataChanged(framenumber);
+   }
+}
+
+/** Objects created from a file keep referring to its memory until they get
+  * decoded, so this has to be called before the file gets released.
+  */
+void Object::detachBlock() {
+   if (encoded) {
+      block = QByteArray(block.constData(), block.size());
+   }
 }
 
 /** This is just a convenience function.
-  * @sa BBox const & lastBBox() const
+  * @sa BBox lastBBox() const
   */
-BBox const & Object::firstBBox() const {
-   return bboxes.constBegin().value();
+BBox Object::firstBBox() const {
+   load();
+   return bboxes.first().unpack(id);
 }
 
 /** If there is no box defined for this frame either a interpolated or a NULL
   * bounding box is constructed and returned, according to the surrounding
-  * boxes.
-  * @sa BBox * getBBox(int framenumber)
+  * boxes. Interpolated geometries are taken from the cached segment.
+  * @sa PackedBBox * getBBoxPointer(int framenumber)
   */
 BBox Object::getBBox(int framenumber) const {
-   QMap<int, BBox>::const_iterator i = bboxes.lowerBound(framenumber);
-   if (i!=bboxes.constEnd()) {
-      if (i.key()==framenumber) {
-         return i.value();
+   const int i = lowerBound(framenumber);
+   if (i<bboxes.size()) {
+      if (bboxes.at(i).framenumber==framenumber) {
+         return bboxes.at(i).unpack(id);
       }
-      else if (i!=bboxes.constBegin() && i.value().type==BBox::KEYBOX) {
-         return interpolate(framenumber, (i-1).value(), i.value());
+      else if (i>0 && bboxes.at(i).type==BBox::KEYBOX) {
+         QVector<QRect> const * segment = interpolatedSegment(i);
+         if (!segment) {
+            // too long to be cached
+            return interpolate(framenumber, bboxes.at(i-1).unpack(id), bboxes.at(i).unpack(id));
+         }
+         return BBox(framenumber,
+                     segment->at(framenumber-bboxes.at(i-1).framenumber-1),
+                     id,
+                     BBox::VIRTUAL);
       }
    }
    return BBox();
@@ -109,31 +328,117 @@ BBox Object::getBBox(int framenumber) const {
 
 /** The box is a existing, modifiable one; instead of interpolated or NULL boxes
   * a NULL pointer is returned.
+  * @note The pointer gets invalid as soon as boxes get added to or removed from
+  * the object.
   * @sa BBox getBBox(int framenumber) const
   */
-BBox * Object::getBBoxPointer(int framenumber) {
-   if (bboxes.contains(framenumber)) {
-      return &bboxes[framenumber];
+PackedBBox * Object::getBBoxPointer(int framenumber) {
+   const int i = lowerBound(framenumber);
+   if (i<bboxes.size() && bboxes.at(i).framenumber==framenumber) {
+      return &bboxes[i];
    }
    else {
       return NULL;
    }
 }
 
-QMap<int, BBox> const & Object::getBBoxes() const {
+QVector<PackedBBox> const & Object::getBBoxes() const {
+   load();
    return bboxes;
 }
 
+/** Only existing boxes are returned, no interpolated or NULL boxes.
+  */
+QList<BBox> Object::getBBoxesInRange(int firstFrame, int lastFrame) const {
+   QList<BBox> result;
+   for (int i=lowerBound(firstFrame); i<bboxes.size() && bboxes.at(i).framenumber<=lastFrame; ++i) {
+      result << bboxes.at(i).unpack(id);
+   }
+   return result;
+}
+
+/** The merged runs are cached, so only the runs overlapping the requested range
+  * get searched and clipped to it. The cost depends on the number of merged
+  * runs in the range instead of the number of boxes or frames.
+  * @sa void buildRuns() const
+  */
+QVector<BBoxRun> Object::getRuns(int firstFrame, int lastFrame) const {
+   if (firstFrame > lastFrame) {
+      return QVector<BBoxRun>();
+   }
+   if (!runsValid) {
+      buildRuns();
+   }
+   // binary search for the first run not ending before firstFrame
+   int first = 0;
+   int last = runs.size();
+   while (first < last) {
+      const int middle = (first+last)/2;
+      if (runs.at(middle).last < firstFrame) {
+         first = middle+1;
+      }
+      else {
+         last = middle;
+      }
+   }
+   QVector<BBoxRun> result;
+   for (int i=first; i<runs.size() && runs.at(i).first<=lastFrame; ++i) {
+      BBoxRun run = runs.at(i);
+      run.first = qMax(run.first, firstFrame);
+      run.last = qMin(run.last, lastFrame);
+      result << run;
+   }
+   return result;
+}
+
+/** Unlike getBBox() no geometry gets interpolated, only the surrounding boxes
+  * are looked up.
+  * @sa BBox getBBox(int framenumber) const
+  */
+BBox::Type Object::getType(int framenumber) const {
+   const int i = lowerBound(framenumber);
+   if (i<bboxes.size()) {
+      if (bboxes.at(i).framenumber==framenumber) {
+         return BBox::Type(bboxes.at(i).type);
+      }
+      else if (i>0 && bboxes.at(i).type==BBox::KEYBOX) {
+         return BBox::VIRTUAL;
+      }
+   }
+   return BBox::NULLTYPE;
+}
+
+/** Encoded boxes don't get decoded.
+  * @sa int getLastFrame() const
+  */
+int Object::getFirstFrame() const {
+   if (encoded) {
+      return blockFirstFrame;
+   }
+   return bboxes.isEmpty() ? 0 : bboxes.first().framenumber;
+}
+
 int Object::getID() const {
    return id;
 }
 
+/** Encoded boxes don't get decoded.
+  * @sa int getFirstFrame() const
+  */
+int Object::getLastFrame() const {
+   if (encoded) {
+      return blockLastFrame;
+   }
+   return bboxes.isEmpty() ? -1 : bboxes.last().framenumber;
+}
+
 /** If no such box exists a NULL pointer is returned.
+  * @sa PackedBBox * getBBoxPointer(int framenumber)
   */
-BBox * Object::getPrecedingBBoxPointer(int framenumber) {
-   QMap<int, BBox>::iterator i = bboxes.lowerBound(framenumber);
-   if (i!=bboxes.begin()) {
-      return &(i-1).value();
+PackedBBox * Object::getPrecedingBBoxPointer(int framenumber) {
+   const int i = lowerBound(framenumber);
+   if (i>0) {
+      return &bboxes[i-1];
    }
    else {
       return NULL;
@@ -148,104 +453,240 @@ QString Object::getViperFramespan() const {
    if (isEmpty()) {
       return QString("0:0");
    }
-   QString span = QString("%1:").arg(firstBBox().framenumber+1);
+   load();
+   QString span = QString("%1:").arg(bboxes.first().framenumber+1);
 
-   QMap<int, BBox>::const_iterator i = bboxes.constBegin()+1;
-   while (i != bboxes.constEnd()) {
-      if (i.value().type==BBox::SINGLE && i.key()!=(i-1).key()+1) {
-         span.append(QString("%1, %2:").arg((i-1).key()+1).arg(i.key()+1));
+   for (int i=1; i<bboxes.size(); ++i) {
+      if (bboxes.at(i).type==BBox::SINGLE && bboxes.at(i).framenumber!=bboxes.at(i-1).framenumber+1) {
+         span.append(QString("%1, %2:").arg(bboxes.at(i-1).framenumber+1).arg(bboxes.at(i).framenumber+1));
       }
-      ++i;
    }
-   span.append(QString("%1").arg((bboxes.constEnd()-1).key()+1));
+   span.append(QString("%1").arg(bboxes.last().framenumber+1));
    return span;
 }
 
+/** Appending boxes in ascending order (like when loading) neither searches nor
+  * moves any boxes.
+  */
+void Object::insertBBox(BBox const & bbox) {
+   load();
+   runsValid = false;
+   if (bboxes.isEmpty() || bboxes.last().framenumber < bbox.framenumber) {
+      bboxes << PackedBBox(bbox);
+      return;
+   }
+   const int i = lowerBound(bbox.framenumber);
+   if (bboxes.at(i).framenumber==bbox.framenumber) {
+      bboxes[i] = PackedBBox(bbox);
+   }
+   else {
+      bboxes.insert(i, PackedBBox(bbox));
+   }
+}
+
+/** The segment gets computed on the first request and stays in the segment
+  * cache of the ObjectStore until one of its two boxes changes or it gets
+  * evicted. Segments longer than the whole cache aren't computed at all and NULL
+  * is returned. The segment is only valid until the next segment gets cached.
+  * @sa void invalidateInterpolation(int framenumber)
+  */
+QVector<QRect> const * Object::interpolatedSegment(int index) const {
+   const int framenumber = bboxes.at(index).framenumber;
+   QVector<QRect> const * segment = objectStore->cachedSegment(segmentKey, framenumber);
+   if (!segment) {
+      const BBox bboxA = bboxes.at(index-1).unpack(id);
+      const BBox bboxB = bboxes.at(index).unpack(id);
+      const int length = bboxB.framenumber-bboxA.framenumber-1;
+      if (length > objectStore->getSegmentCacheSize()) {
+         return NULL;
+      }
+      QVector<QRect> * rects = new QVector<QRect>(length);
+      interpolateSegment(bboxA, bboxB, rects->data());
+      segment = objectStore->cacheSegment(segmentKey, framenumber, rects);
+   }
+   return segment;
+}
+
+/** The segments ending at the box and at its successor get dropped. This has to
+  * be called whenever a box gets modified through a pointer, adding or deleting
+  * boxes does it on its own.
+  */
+void Object::invalidateInterpolation(int framenumber) {
+   objectStore->uncacheSegment(segmentKey, framenumber);
+   const int next = lowerBound(framenumber+1);
+   if (next < bboxes.size()) {
+      objectStore->uncacheSegment(segmentKey, bboxes.at(next).framenumber);
+   }
+}
+
 /** Internal simply the corresponding
-  * <a href="http://qt-project.org/doc/qt-4.8/qmap.html#isEmpty">isEmpty</a>
+  * <a href="http://qt-project.org/doc/qt-4.8/qvector.html#isEmpty">isEmpty</a>
   * function of the
-  * <a href="http://qt-project.org/doc/qt-4.8/qmap.html">QMap</a>
-  * containing the bounding boxes is forwarded.
+  * <a href="http://qt-project.org/doc/qt-4.8/qvector.html">QVector</a>
+  * containing the bounding boxes is forwarded. Encoded boxes don't get decoded.
   */
 bool Object::isEmpty() const {
+   if (encoded) {
+      return blockLastFrame < blockFirstFrame;
+   }
    return bboxes.isEmpty();
 }
 
 /** This is just a convenience function.
-  * @sa BBox const & firstBBox() const
+  * @sa BBox firstBBox() const
+  */
+BBox Object::lastBBox() const {
+   load();
+   return bboxes.last().unpack(id);
+}
+
+/** The boxes are sorted by their framenumber, so a binary search is used. If
+  * all boxes lie before \a framenumber the size of #bboxes is returned. Every
+  * access to single boxes starts here, so the boxes get decoded if necessary.
+  */
+int Object::lowerBound(int framenumber) const {
+   load();
+   int first = 0;
+   int last = bboxes.size();
+   while (first < last) {
+      const int middle = (first+last)/2;
+      if (bboxes.at(middle).framenumber < framenumber) {
+         first = middle+1;
+      }
+      else {
+         last = middle;
+      }
+   }
+   return first;
+}
+
+/** Only the virtual boxes between the surrounding boxes can change along with
+  * the box at \a framenumber, so the range reaches from the frame after the
+  * preceding box to the frame before the succeeding one.
   */
-BBox const & Object::lastBBox() const {
-   return (bboxes.constEnd()-1).value();
+void Object::notifyDataChanged(int framenumber) {
+   const int previous = lowerBound(framenumber)-1;
+   const int next = lowerBound(framenumber+1);
+   const int firstFrame = previous>=0 ? bboxes.at(previous).framenumber+1 : framenumber;
+   const int lastFrame = next<bboxes.size() ? bboxes.at(next).framenumber-1 : framenumber;
+   objectStore->notifyDataChanged(id, firstFrame, lastFrame);
+}
+
+/** Objects created from a file keep referring to its memory until they get
+  * decoded. After saving, the saved file holds the same block, so the object
+  * can refer to it instead and the old file can be released without copying
+  * the block. Decoded objects aren't affected.
+  * @sa void detachBlock()
+  */
+void Object::rebaseBlock(char const * data) {
+   if (encoded) {
+      block = QByteArray::fromRawData(data, block.size());
+   }
 }
 
 /** The data is saved in the BTD file format.
   */
 void Object::save(QDataStream & out) const {
+   load();
    out << (quint32)id;
    out << (quint32)bboxes.size();
-   foreach (BBox const & bbox, bboxes) {
+   foreach (PackedBBox const & bbox, bboxes) {
       out << (quint8)bbox.type;
       out << (quint32)bbox.framenumber;
       out << bbox.rect;
    }
 }
 
+/** The boxes get stored column by column: the number of boxes, the
+  * framenumbers, the types as runs of equal types and the x, y, width and height
+  * of the boxes. Framenumbers and coordinates are stored as differences to the
+  * ones of the preceding box, all numbers are variable length integers, so a
+  * box typically takes only a few bytes. Blocks that weren't decoded yet are
+  * returned as they are, unless they are damaged.
+  * @sa void decode() const
+  */
+QByteArray Object::toBlock() const {
+   if (encoded && qChecksum(block.constData(), block.size()) == blockChecksum) {
+      return block;
+   }
+   load();
+   QByteArray data;
+   data.reserve(8+6*bboxes.size());
+   appendVarint(data, bboxes.size());
+
+   int previous = 0;
+   foreach (PackedBBox const & bbox, bboxes) {
+      appendVarint(data, zigzag(bbox.framenumber-previous));
+      previous = bbox.framenumber;
+   }
+
+   QByteArray runs;
+   quint32 runCount = 0;
+   for (int i=0; i<bboxes.size(); ) {
+      int j = i+1;
+      while (j<bboxes.size() && bboxes.at(j).type==bboxes.at(i).type) {
+         ++j;
+      }
+      runs.append(char(bboxes.at(i).type));
+      appendVarint(runs, j-i);
+      ++runCount;
+      i = j;
+   }
+   appendVarint(data, runCount);
+   data.append(runs);
+
+   for (int column=0; column<4; ++column) {
+      previous = 0;
+      foreach (PackedBBox const & bbox, bboxes) {
+         const int value = rectColumn(bbox.rect, column);
+         appendVarint(data, zigzag(value-previous));
+         previous = value;
+      }
+   }
+   return data;
+}
+
 /** @note If there are virtual boxes they get saved as single boxes except for
   * stationary ones (where the two spanning boxes have the same geometry) which
   * get saved using ViPER's run length encoding.
+  * @sa <a href="http://qt-project.org/doc/qt-4.8/qxmlstreamwriter.html">QXmlStreamWriter</a>
   */
-QDomElement Object::toViperNode(QDomDocument & doc, QString const & catName) const {
-   QDomElement objectDE = doc.createElement("object");
-   objectDE.setAttribute("framespan", getViperFramespan());
-   objectDE.setAttribute("id", id);
-   objectDE.setAttribute("name", catName);
+void Object::writeViperNode(QXmlStreamWriter & writer, QString const & catName) const {
+   load();
+   writer.writeStartElement("object");
+   writer.writeAttribute("framespan", getViperFramespan());
+   writer.writeAttribute("id", QString::number(id));
+   writer.writeAttribute("name", catName);
 
-   QDomElement attributeDE = doc.createElement("attribute");
-   attributeDE.setAttribute("name", "BoundingBox");
-   objectDE.appendChild(attributeDE);
+   writer.writeStartElement("attribute");
+   writer.writeAttribute("name", "BoundingBox");
 
-   QMap<int, BBox>::const_iterator i = bboxes.constBegin();
-   while (i != bboxes.constEnd()) {
-      if (i!=bboxes.constBegin() && i.value().type == BBox::KEYBOX) {
+   int i = 0;
+   while (i < bboxes.size()) {
+      if (i>0 && bboxes.at(i).type == BBox::KEYBOX) {
          // output interpolated BBs
-         for (int j=(i-1).key()+1; j<i.key(); ++j) {
-            const BBox bbox = interpolate(j, (i-1).value(), i.value());
-            QDomElement databboxDE = doc.createElement("data:bbox");
+         QVector<QRect> rects(bboxes.at(i).framenumber-bboxes.at(i-1).framenumber-1);
+         interpolateSegment(bboxes.at(i-1).unpack(id), bboxes.at(i).unpack(id), rects.data());
+         for (int j=0; j<rects.size(); ++j) {
             // viper has 1-based framenumbers, default is 0-based!
-            databboxDE.setAttribute("framespan", QString("%1:%1").arg(bbox.framenumber+1));
-            databboxDE.setAttribute("x", bbox.rect.x());
-            databboxDE.setAttribute("y", bbox.rect.y());
-            databboxDE.setAttribute("width", bbox.rect.width());
-            databboxDE.setAttribute("height", bbox.rect.height());
-            attributeDE.appendChild(databboxDE);
+            writeViperBBox(writer, QString("%1:%1").arg(bboxes.at(i-1).framenumber+j+2), rects.at(j));
          }
       }
-      if ((i+1)!=bboxes.constEnd() && (i+1).value().type==BBox::KEYBOX && i.value().rect == (i+1).value().rect) {
+      if (i+1<bboxes.size() && bboxes.at(i+1).type==BBox::KEYBOX && bboxes.at(i).rect == bboxes.at(i+1).rect) {
          // Merge BBs to RLE bounding box
-         QDomElement databboxDE = doc.createElement("data:bbox");
          // viper has 1-based framenumbers, default is 0-based!
-         databboxDE.setAttribute("framespan", QString("%1:%2").arg(i.key()+1).arg((i+1).key()+1));
-         databboxDE.setAttribute("x", i.value().rect.x());
-         databboxDE.setAttribute("y", i.value().rect.y());
-         databboxDE.setAttribute("width", i.value().rect.width());
-         databboxDE.setAttribute("height", i.value().rect.height());
-         attributeDE.appendChild(databboxDE);
+         writeViperBBox(writer, QString("%1:%2").arg(bboxes.at(i).framenumber+1).arg(bboxes.at(i+1).framenumber+1), bboxes.at(i).rect);
          ++i;
       }
       else {
-         QDomElement databboxDE = doc.createElement("data:bbox");
          // viper has 1-based framenumbers, default is 0-based!
-         databboxDE.setAttribute("framespan", QString("%1:%1").arg(i.key()+1));
-         databboxDE.setAttribute("x", i.value().rect.x());
-         databboxDE.setAttribute("y", i.value().rect.y());
-         databboxDE.setAttribute("width", i.value().rect.width());
-         databboxDE.setAttribute("height", i.value().rect.height());
-         attributeDE.appendChild(databboxDE);
+         writeViperBBox(writer, QString("%1:%1").arg(bboxes.at(i).framenumber+1), bboxes.at(i).rect);
       }
       ++i;
    }
 
-   return objectDE;
+   writer.writeEndElement();
+   writer.writeEndElement();
 }
 
 /** A object counts as less than another if its ID is less than the others
@@ -261,10 +702,10 @@ bool lessThanByID(Object const * const object1, Object const * const object2) {
   * @relates Object
   */
 bool lessThanByFN(Object const * const object1, Object const * const object2) {
-   const int framenumber1 = object1->firstBBox().framenumber;
-   const int framenumber2 = object2->firstBBox().framenumber;
+   const int framenumber1 = object1->getFirstFrame();
+   const int framenumber2 = object2->getFirstFrame();
    if (framenumber1 == framenumber2) {
-      return object1->lastBBox().framenumber < object2->lastBBox().framenumber;
+      return object1->getLastFrame() < object2->getLastFrame();
    }
    else {
       return framenumber1 < framenumber2;
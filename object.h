@@ -1,65 +1,111 @@
 #ifndef OBJECT_H
 #define OBJECT_H
 
-#include <QtCore/QMap>
-#include <QtCore/QObject>
 #include <QtCore/QRect>
-#include <QtXml/QDomElement>
+#include <QtCore/QVector>
 #include "types.h"
 
+class QXmlStreamReader;
+class QXmlStreamWriter;
+
 /// Represents a object in the video consisting of several \ref BBox "BBox"es.
 /** In detail the class only consists of a unique ID given at creation and a
-  * QMap of BBox instances.
+  * QVector of PackedBBox instances sorted by their framenumber. Objects read
+  * from a BTD file keep their boxes encoded until they get accessed, only the
+  * framenumbers of the first and the last box are known before.
+  * Objects live in the ObjectStore, which creates and destroys them and emits
+  * ObjectStore::dataChanged() for them.
   */
-class Object : public QObject {
+class Object {
 
-   Q_OBJECT
+   friend class ObjectStore;
 
 public:
-   /// Creates an empty object.
-   Object();
-   /// Creates an object from a stream
-   explicit Object(QDataStream & in);
-   /// Creates an object from a <a href="http://qt-project.org/doc/qt-4.8/qdomelement.html">QDomElement</a> containing an object node from a viper file.
-   explicit Object(QDomElement const & objectElem);
    /// Adds the bounding box \a bbox to the internal list.
    void addBBox(BBox const & bbox);
+   /// Adds all the bounding boxes \a newBBoxes at once.
+   void addBBoxes(QList<BBox> const & newBBoxes);
    /// Removes the bounding box with the given \a framenumber from the internal list.
    void deleteBBoxAt(int framenumber);
    /// Getter for #id.
    int getID() const;
    /// Returns a bounding box for the specified \a framenumber.
    BBox getBBox(int framenumber) const;
+   /// Returns the type of the bounding box for the specified \a framenumber.
+   BBox::Type getType(int framenumber) const;
+   /// Returns the runs of equally typed boxes overlapping the frames \a firstFrame to \a lastFrame.
+   QVector<BBoxRun> getRuns(int firstFrame, int lastFrame) const;
    /// Returns a pointer to the bounding box for the specified \a framenumber.
-   BBox * getBBoxPointer(int framenumber);
+   PackedBBox * getBBoxPointer(int framenumber);
    /// Returns a pointer to the bounding box preceding the box with the given \a framenumber.
-   BBox * getPrecedingBBoxPointer(int framenumber);
+   PackedBBox * getPrecedingBBoxPointer(int framenumber);
    /// Getter for #bboxes.
-   QMap<int, BBox> const & getBBoxes() const;
+   QVector<PackedBBox> const & getBBoxes() const;
+   /// Returns the bounding boxes with framenumbers from \a firstFrame to \a lastFrame.
+   QList<BBox> getBBoxesInRange(int firstFrame, int lastFrame) const;
    /// Returns true if the object doesn't contain any bounding boxes.
    bool isEmpty() const;
-   /// Returns a <a href="http://qt-project.org/doc/qt-4.8/qdomelement.html">QDomElement</a> containing the object in the viper format.
-   QDomElement toViperNode(QDomDocument & doc, QString const & catName) const;
-   /// Returns a reference to the first existing bounding box
-   BBox const & firstBBox() const;
-   /// Returns a reference to the last existing bounding box
-   BBox const & lastBBox() const;
+   /// Returns the framenumber of the first bounding box or 0 if the object is empty.
+   int getFirstFrame() const;
+   /// Returns the framenumber of the last bounding box or -1 if the object is empty.
+   int getLastFrame() const;
+   /// Writes the object as a node in the viper format to the \a writer.
+   void writeViperNode(QXmlStreamWriter & writer, QString const & catName) const;
+   /// Returns the first existing bounding box
+   BBox firstBBox() const;
+   /// Returns the last existing bounding box
+   BBox lastBBox() const;
    /// Saves the data to a stream
    void save(QDataStream & out) const;
-
-signals:
-   /// Gets emitted when a bbox gets added directly.
-   /** This is used to inform the wrapping category about changes made directly
-     * to this class.
-     */
-   void dataChanged(int objectID, int framenumber);
+   /// Returns the bounding boxes encoded as an object block of the BTD file format version 2.
+   QByteArray toBlock() const;
+   /// Copies the encoded bounding boxes if they still refer to the memory of a file.
+   void detachBlock();
+   /// Points the encoded bounding boxes to an identical block at \a data.
+   void rebaseBlock(char const * data);
+   /// Drops the cached interpolations next to the box with the given \a framenumber.
+   void invalidateInterpolation(int framenumber);
 
 private:
-   int id;                 ///< The unique ID of the object.
-   QMap<int, BBox> bboxes; ///< The list of bounding boxes.
+   int id;                                       ///< The unique ID of the object.
+   mutable QVector<PackedBBox> bboxes;           ///< The bounding boxes sorted by their framenumber.
+   quint32 segmentKey;                           ///< Key of the interpolated segments of the object in the segment cache of the ObjectStore.
+   mutable QVector<BBoxRun> runs;                ///< Merged runs of all boxes, valid if #runsValid is set.
+   mutable bool runsValid;                       ///< Indicates that the #runs match the #bboxes.
+   mutable QByteArray block;                     ///< The encoded bounding boxes as long as they aren't decoded.
+   mutable bool encoded;                         ///< Indicates that the #bboxes still have to be decoded from the #block.
+   quint16 blockChecksum;                        ///< CRC-16 of the #block.
+   int blockFirstFrame;                          ///< Framenumber of the first box in the #block.
+   int blockLastFrame;                           ///< Framenumber of the last box in the #block.
 
+   /// Creates an empty object.
+   Object();
+   /// Creates an object from a stream
+   explicit Object(QDataStream & in);
+   /// Creates an object from the object node of a viper file the \a reader is positioned at.
+   explicit Object(QXmlStreamReader & reader);
+   /// Creates an object with the given \a id from an object \a block of a BTD file in version 2.
+   Object(int id, QByteArray const & block, quint16 checksum, int firstFrame, int lastFrame);
+   /// Objects get destroyed by the ObjectStore only.
+   ~Object();
+   /// Decodes the #bboxes if they are still encoded.
+   void load() const;
+   /// Decodes the #bboxes from the #block.
+   void decode() const;
+   /// Derives the #runs from the #bboxes.
+   void buildRuns() const;
+   /// Inserts the \a bbox without invalidating interpolations or emitting signals.
+   void insertBBox(BBox const & bbox);
+   /// Returns the index of the first box with a framenumber not less than \a framenumber.
+   int lowerBound(int framenumber) const;
+   /// Reports the frames affected by a change at \a framenumber to the ObjectStore.
+   void notifyDataChanged(int framenumber);
+   /// Returns the interpolated geometries between the box at \a index and its predecessor.
+   QVector<QRect> const * interpolatedSegment(int index) const;
    /// Returns the framespan of the object as a string.
    QString getViperFramespan() const;
+
+   Q_DISABLE_COPY(Object)
 };
 
 /// Compares two objects by their IDs
@@ -0,0 +1,148 @@
+#include "objectstore.h"
+#include <new>
+#include "object.h"
+
+/// Combines the \a segmentKey of an object and the \a framenumber of the last box of a segment to the key of the segment cache.
+inline quint64 segmentCacheKey(quint32 segmentKey, int framenumber) {
+   return (quint64(segmentKey) << 32) | quint32(framenumber);
+}
+
+/** No memory gets allocated until the first object is created.
+  */
+ObjectStore::ObjectStore() :
+   QObject(), usedInLastBlock(objectsPerBlock), segments(segmentCacheSize), nextSegmentKey(0)
+{
+}
+
+/** Slots of destroyed objects are used first, then the next slot of the last
+  * block. A new block gets allocated once the last one is used up. The blocks
+  * never get returned, as the store lives as long as the application.
+  */
+void * ObjectStore::allocate() {
+   if (!freeSlots.isEmpty()) {
+      Object * slot = freeSlots.last();
+      freeSlots.remove(freeSlots.size()-1);
+      return slot;
+   }
+   if (usedInLastBlock == objectsPerBlock) {
+      blocks << static_cast<char *>(::operator new(objectsPerBlock*sizeof(Object)));
+      usedInLastBlock = 0;
+   }
+   return blocks.last() + sizeof(Object)*usedInLastBlock++;
+}
+
+/** The cost of a segment is the number of its geometries, the least recently
+  * used segments get evicted once the cache exceeds #segmentCacheSize. If the
+  * segment alone exceeds it, it gets deleted right away and NULL is returned.
+  * Otherwise the returned segment stays valid until the next one gets cached.
+  * @note Like the interpolation of segments, the cache may only be used by the
+  * GUI thread.
+  */
+QVector<QRect> const * ObjectStore::cacheSegment(quint32 segmentKey, int framenumber, QVector<QRect> * rects) {
+   const quint64 key = segmentCacheKey(segmentKey, framenumber);
+   return segments.insert(key, rects, rects->size()) ? segments.object(key) : NULL;
+}
+
+/** Looking a segment up marks it as recently used.
+  */
+QVector<QRect> const * ObjectStore::cachedSegment(quint32 segmentKey, int framenumber) {
+   return segments.object(segmentCacheKey(segmentKey, framenumber));
+}
+
+/** The object gets assigned a unique ID.
+  * @sa Object::Object()
+  */
+Object * ObjectStore::create() {
+   return new (allocate()) Object();
+}
+
+/** @sa Object::Object(QDataStream & in)
+  */
+Object * ObjectStore::create(QDataStream & in) {
+   return new (allocate()) Object(in);
+}
+
+/** @sa Object::Object(QXmlStreamReader & reader)
+  */
+Object * ObjectStore::create(QXmlStreamReader & reader) {
+   return new (allocate()) Object(reader);
+}
+
+/** The \a block has to stay valid until the object is decoded or
+  * Object::detachBlock() got called.
+  * @sa Object::Object(int id, QByteArray const & block, quint16 checksum, int firstFrame, int lastFrame)
+  */
+Object * ObjectStore::create(int id, QByteArray const & block, quint16 checksum, int firstFrame, int lastFrame) {
+   return new (allocate()) Object(id, block, checksum, firstFrame, lastFrame);
+}
+
+/** The slot gets reused by one of the next objects created, so the \a object
+  * must not be used any more. NULL pointers are ignored.
+  */
+void ObjectStore::destroy(Object * object) {
+   if (object) {
+      object->~Object();
+      freeSlots << object;
+   }
+}
+
+void ObjectStore::destroy(QList<Object *> const & objects) {
+   foreach (Object * object, objects) {
+      destroy(object);
+   }
+}
+
+/** The global instance is not really global but a function static one, just
+  * like the IDCounter's.
+  */
+ObjectStore * ObjectStore::getGlobalInstance() {
+   static ObjectStore * store = new ObjectStore();
+   return store;
+}
+
+int ObjectStore::getSegmentCacheSize() const {
+   return segments.maxCost();
+}
+
+/** Objects get their first key while being created, possibly on other threads,
+  * so the counter is atomic. Wrapping around takes 2^32 keys.
+  */
+quint32 ObjectStore::newSegmentKey() {
+   return quint32(nextSegmentKey.fetchAndAddRelaxed(1));
+}
+
+/** Objects get decoded on their first access, which might happen while they
+  * are being painted or queried or on another thread, so the report gets
+  * deferred to the event loop of the store's thread. All objects found damaged
+  * until then are reported at once.
+  * @sa void reportDamaged()
+  */
+void ObjectStore::notifyDamaged(int objectID, int firstFrame, int lastFrame) {
+   QMutexLocker locker(&damagedMutex);
+   if (damaged.isEmpty()) {
+      QMetaObject::invokeMethod(this, "reportDamaged", Qt::QueuedConnection);
+   }
+   damaged.insert(objectID, qMakePair(firstFrame, lastFrame));
+}
+
+void ObjectStore::notifyDataChanged(int objectID, int firstFrame, int lastFrame) {
+   emit dataChanged(objectID, firstFrame, lastFrame);
+}
+
+/** The objects are empty now, so #dataChanged makes the categories drop their
+  * lifespans.
+  */
+void ObjectStore::reportDamaged() {
+   QMutexLocker locker(&damagedMutex);
+   const QHash<int, QPair<int, int> > reported = damaged;
+   damaged.clear();
+   locker.unlock();
+   for (QHash<int, QPair<int, int> >::const_iterator it=reported.constBegin(); it!=reported.constEnd(); ++it) {
+      emit dataChanged(it.key(), it.value().first, it.value().second);
+   }
+   emit objectsDamaged(reported.keys());
+}
+
+void ObjectStore::uncacheSegment(quint32 segmentKey, int framenumber) {
+   segments.remove(segmentCacheKey(segmentKey, framenumber));
+}
@@ -0,0 +1,99 @@
+#ifndef OBJECTSTORE_H
+#define OBJECTSTORE_H
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCache>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QPair>
+#include <QtCore/QRect>
+#include <QtCore/QVector>
+
+class Object;
+class QByteArray;
+class QDataStream;
+class QXmlStreamReader;
+
+/// A simple define to make calling the global instance easier @relates ObjectStore
+#define objectStore ObjectStore::getGlobalInstance()
+
+/// Class owning the memory of all \ref Object "Object"s
+/** Objects are no QObjects, so they don't carry any meta object or connection
+  * bookkeeping. Instead they get placed in blocks of memory allocated by the
+  * store and report their changes to the store, which emits them as a single
+  * signal. Receivers filter the signal by the object ID, so there is one
+  * connection per receiver instead of one per object.
+  * Objects have to be created and destroyed via the store, the slots of
+  * destroyed objects get reused by the next objects created.
+  * The interpolated segments of all objects share one cache of limited size,
+  * so playing through a long video doesn't keep every segment in memory. Each
+  * object caches its segments under a key that is never handed out again, so
+  * segments of destroyed objects simply get evicted.
+  */
+class ObjectStore : public QObject {
+
+   Q_OBJECT
+
+public:
+   /// Creates an empty object.
+   Object * create();
+   /// Creates an object from a stream \a in.
+   Object * create(QDataStream & in);
+   /// Creates an object from the viper object node the \a reader is positioned at.
+   Object * create(QXmlStreamReader & reader);
+   /// Creates an object with the given \a id from an object \a block, which gets decoded on first access.
+   Object * create(int id, QByteArray const & block, quint16 checksum, int firstFrame, int lastFrame);
+   /// Destroys the \a object and frees its slot.
+   void destroy(Object * object);
+   /// Destroys all the \a objects.
+   void destroy(QList<Object *> const & objects);
+   /// Emits #dataChanged on behalf of the object with the given \a objectID.
+   void notifyDataChanged(int objectID, int firstFrame, int lastFrame);
+   /// Reports that the object with the given \a objectID lost the boxes from \a firstFrame to \a lastFrame as its block is damaged.
+   void notifyDamaged(int objectID, int firstFrame, int lastFrame);
+   /// Returns a key for the interpolated segments of an object that was never handed out before.
+   quint32 newSegmentKey();
+   /// Returns the segment cached under the \a segmentKey and the \a framenumber of its last box, or NULL if it isn't cached.
+   QVector<QRect> const * cachedSegment(quint32 segmentKey, int framenumber);
+   /// Caches the segment \a rects under the \a segmentKey and the \a framenumber of its last box and takes their ownership.
+   QVector<QRect> const * cacheSegment(quint32 segmentKey, int framenumber, QVector<QRect> * rects);
+   /// Drops the segment cached under the \a segmentKey and the \a framenumber of its last box.
+   void uncacheSegment(quint32 segmentKey, int framenumber);
+   /// Returns the maximum number of interpolated geometries cached for all objects.
+   int getSegmentCacheSize() const;
+   /// returns a pointer to the global instance
+   static ObjectStore * getGlobalInstance();
+
+signals:
+   /// Gets emitted when a bbox of the object with the given \a objectID gets added or deleted directly.
+   /** The frames from \a firstFrame to \a lastFrame cover all boxes whose type
+     * or geometry could have changed.
+     */
+   void dataChanged(int objectID, int firstFrame, int lastFrame);
+   /// Gets emitted once after one or more objects turned out to be damaged, with the \a objectIDs of all of them.
+   void objectsDamaged(QList<int> const & objectIDs);
+
+private:
+   static const int objectsPerBlock = 1024; ///< Number of object slots allocated at once
+   static const int segmentCacheSize = 1 << 19; ///< Number of interpolated geometries (8 MB) cached for all objects
+   QList<char *> blocks;                    ///< The allocated blocks of memory
+   QVector<Object *> freeSlots;             ///< Slots of destroyed objects that can be reused
+   int usedInLastBlock;                     ///< Number of slots handed out from the last block
+   QHash<int, QPair<int, int> > damaged;    ///< Lost frames by the IDs of damaged objects not reported yet
+   QMutex damagedMutex;                     ///< Guards #damaged, as objects may get decoded on other threads
+   QCache<quint64, QVector<QRect> > segments; ///< Interpolated segments by the segment key of their object and the framenumber of their last box
+   QAtomicInt nextSegmentKey;               ///< The segment key handed out next
+
+   /// Default c'tor.
+   ObjectStore();
+   /// Returns the memory for one object.
+   void * allocate();
+
+private slots:
+   /// Emits #dataChanged for each of the #damaged objects and #objectsDamaged for all of them.
+   void reportDamaged();
+};
+
+#endif // OBJECTSTORE_H
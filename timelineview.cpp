@@ -0,0 +1,376 @@
+#include "timelineview.h"
+#include <QtCore/qmath.h>
+#include <QtGui/QHeaderView>
+#include <QtGui/QPainter>
+#include <QtGui/QPaintEvent>
+#include <QtGui/QScrollBar>
+#include "category.h"
+#include "object.h"
+
+/** The row header gets created with the same row height the table views used.
+  */
+TimelineView::TimelineView(QWidget * parent) :
+   QAbstractItemView(parent),
+   rowHeader(new QHeaderView(Qt::Vertical, this)),
+   frameWidth(1.0),
+   rowHeight(20)
+{
+   rowHeader->setDefaultSectionSize(rowHeight);
+   rowHeader->setResizeMode(QHeaderView::Fixed);
+   rowHeader->setClickable(true);
+   connect(rowHeader, SIGNAL(sectionPressed(int)), this, SLOT(selectRow(int)));
+   setHorizontalScrollMode(ScrollPerPixel);
+   setVerticalScrollMode(ScrollPerPixel);
+}
+
+/**
+ * The color depends on the given \a type and if it is \a light or not.
+ * @sa <a href="http://colorbrewer2.org/index.php?type=qualitative&scheme=Set2&n=3">
+ * colorbrewer2.org</a>
+ */
+QColor TimelineView::color(BBox::Type type, bool light) {
+   if (light) {
+      switch (type) {
+      case BBox::SINGLE:
+         return QColor(102, 194, 165);
+      case BBox::KEYBOX:
+         return QColor(252, 141, 98);
+      case BBox::VIRTUAL:
+         return QColor(141, 160, 203);
+      default:
+         return QColor();
+      }
+   }
+   else {
+      switch (type) {
+      case BBox::SINGLE:
+         return QColor(27, 158, 119);
+      case BBox::KEYBOX:
+         return QColor(217, 95, 2);
+      case BBox::VIRTUAL:
+         return QColor(117, 112, 179);
+      default:
+         return QColor();
+      }
+   }
+}
+
+int TimelineView::columnAt(int x) const {
+   return qFloor((x+horizontalOffset())/frameWidth);
+}
+
+/** Category reports changes per object, so only the affected rows get repainted
+  * over the whole width.
+  */
+void TimelineView::dataChanged(QModelIndex const & topLeft, QModelIndex const & bottomRight) {
+   const int top = topLeft.row()*rowHeight - verticalOffset();
+   const int bottom = (bottomRight.row()+1)*rowHeight - verticalOffset();
+   viewport()->update(0, top, viewport()->width(), bottom-top);
+}
+
+/** Frame borders get rounded down, so consecutive frames never overlap or leave
+  * gaps, even if a frame is narrower than a pixel.
+  */
+int TimelineView::frameLeft(int frame) const {
+   return qFloor(frame*frameWidth);
+}
+
+int TimelineView::horizontalOffset() const {
+   return horizontalScrollBar()->value();
+}
+
+/** Returns an invalid index if there is no item at the \a point.
+  */
+QModelIndex TimelineView::indexAt(QPoint const & point) const {
+   if (!model() || point.x()+horizontalOffset() < 0 || point.y()+verticalOffset() < 0) {
+      return QModelIndex();
+   }
+   return model()->index(rowAt(point.y()), columnAt(point.x()), rootIndex());
+}
+
+bool TimelineView::isIndexHidden(QModelIndex const &) const {
+   return false;
+}
+
+/** The actions behave like in a QTableView: columns are frames, rows are
+  * objects and home/end jump to the first/last frame (and the first/last object
+  * if the control key is pressed).
+  */
+QModelIndex TimelineView::moveCursor(CursorAction cursorAction, Qt::KeyboardModifiers modifiers) {
+   if (!model()) {
+      return QModelIndex();
+   }
+   const int rows = model()->rowCount(rootIndex());
+   const int columns = model()->columnCount(rootIndex());
+   const QModelIndex current = currentIndex();
+   if (!current.isValid()) {
+      return model()->index(0, 0, rootIndex());
+   }
+   int row = current.row();
+   int column = current.column();
+   const int pageRows = qMax(1, viewport()->height()/rowHeight);
+   switch (cursorAction) {
+   case MoveLeft:
+   case MovePrevious:
+      column = qMax(0, column-1);
+      break;
+   case MoveRight:
+   case MoveNext:
+      column = qMin(columns-1, column+1);
+      break;
+   case MoveUp:
+      row = qMax(0, row-1);
+      break;
+   case MoveDown:
+      row = qMin(rows-1, row+1);
+      break;
+   case MovePageUp:
+      row = qMax(0, row-pageRows);
+      break;
+   case MovePageDown:
+      row = qMin(rows-1, row+pageRows);
+      break;
+   case MoveHome:
+      column = 0;
+      if (modifiers & Qt::ControlModifier) {
+         row = 0;
+      }
+      break;
+   case MoveEnd:
+      column = columns-1;
+      if (modifiers & Qt::ControlModifier) {
+         row = rows-1;
+      }
+      break;
+   }
+   return model()->index(row, column, rootIndex());
+}
+
+/** Only the visible rows get painted. For each of them the selection is drawn
+  * as background and the runs of the object within the visible frames on top.
+  * @sa QVector<BBoxRun> Object::getRuns(int firstFrame, int lastFrame) const
+  */
+void TimelineView::paintEvent(QPaintEvent * event) {
+   Category const * const category = qobject_cast<Category const *>(model());
+   if (!category) {
+      return;
+   }
+   QPainter painter(viewport());
+   const QRect area = event->rect();
+   const int firstRow = qMax(0, rowAt(area.top()));
+   const int lastRow = qMin(category->rowCount()-1, rowAt(area.bottom()));
+   const int firstFrame = qMax(0, columnAt(area.left()));
+   const int lastFrame = qMin(category->columnCount()-1, columnAt(area.right()));
+
+   foreach (QItemSelectionRange const & range, selectionModel()->selection()) {
+      const QRect rect = QRect(visualRect(range.topLeft()).topLeft(),
+                               visualRect(range.bottomRight()).bottomRight());
+      painter.fillRect(rect.intersected(area), palette().highlight());
+   }
+
+   for (int row=firstRow; row<=lastRow; ++row) {
+      const int top = row*rowHeight - verticalOffset();
+      foreach (BBoxRun const & run, category->getObjects().at(row)->getRuns(firstFrame, lastFrame)) {
+         paintRun(painter, run, top);
+      }
+   }
+
+   const QModelIndex current = currentIndex();
+   if (current.isValid()) {
+      painter.setPen(palette().color(QPalette::Text));
+      painter.setBrush(Qt::NoBrush);
+      painter.drawRect(visualRect(current).adjusted(0, 0, -1, -1));
+   }
+}
+
+/** The run is drawn as one bar, with the same heights the per frame pixmaps
+  * had. If single frames are wide enough the existing boxes get separated.
+  */
+void TimelineView::paintRun(QPainter & painter, BBoxRun const & run, int top) const {
+   const int frameSize = qBound(1, qFloor(frameWidth), 16);
+   const int height = run.type==BBox::VIRTUAL ? qMax(8, frameSize-4) : qMax(12, frameSize);
+   const int left = frameLeft(run.first) - horizontalOffset();
+   const int right = frameLeft(run.last+1) - horizontalOffset();
+   const QRect rect(left, top+(rowHeight-height)/2, qMax(1, right-left), height);
+   const QColor border(0, 0, 0, 127);
+
+   painter.fillRect(rect, color(run.type));
+   if (rect.width() > 2) {
+      painter.setPen(border);
+      painter.setBrush(Qt::NoBrush);
+      painter.drawRect(rect.adjusted(0, 0, -1, -1));
+   }
+   if (frameWidth >= 4.0 && run.type != BBox::VIRTUAL) {
+      painter.setPen(border);
+      for (int frame=run.first+1; frame<=run.last; ++frame) {
+         const int x = frameLeft(frame) - horizontalOffset();
+         painter.drawLine(x, rect.top(), x, rect.bottom());
+      }
+   }
+}
+
+void TimelineView::reset() {
+   QAbstractItemView::reset();
+   updateGeometries();
+}
+
+int TimelineView::rowAt(int y) const {
+   return qFloor(qreal(y+verticalOffset())/rowHeight);
+}
+
+void TimelineView::rowsInserted(QModelIndex const & parent, int start, int end) {
+   QAbstractItemView::rowsInserted(parent, start, end);
+   updateGeometries();
+}
+
+void TimelineView::scrollContentsBy(int dx, int dy) {
+   QAbstractItemView::scrollContentsBy(dx, dy);
+   rowHeader->setOffset(verticalOffset());
+}
+
+/** Nothing happens if the \a index is invalid.
+  */
+void TimelineView::scrollTo(QModelIndex const & index, ScrollHint hint) {
+   if (!index.isValid()) {
+      return;
+   }
+   const QRect rect = visualRect(index);
+   const QRect area = viewport()->rect();
+   int dx = 0;
+   int dy = 0;
+   if (hint == PositionAtCenter) {
+      dx = rect.center().x() - area.center().x();
+      dy = rect.center().y() - area.center().y();
+   }
+   else {
+      if (rect.left() < area.left()) {
+         dx = rect.left() - area.left();
+      }
+      else if (rect.right() > area.right()) {
+         dx = qMin(rect.right() - area.right(), rect.left() - area.left());
+      }
+      if (hint == PositionAtTop) {
+         dy = rect.top() - area.top();
+      }
+      else if (hint == PositionAtBottom) {
+         dy = rect.bottom() - area.bottom();
+      }
+      else if (rect.top() < area.top()) {
+         dy = rect.top() - area.top();
+      }
+      else if (rect.bottom() > area.bottom()) {
+         dy = qMin(rect.bottom() - area.bottom(), rect.top() - area.top());
+      }
+   }
+   horizontalScrollBar()->setValue(horizontalOffset()+dx);
+   verticalScrollBar()->setValue(verticalOffset()+dy);
+   viewport()->update(visualRect(index));
+}
+
+/** This gets called when a section of the row header is pressed.
+  */
+void TimelineView::selectRow(int row) {
+   setCurrentIndex(model()->index(row, qMax(0, currentIndex().column()), rootIndex()));
+}
+
+/** The row header shows the vertical header data of the \a model.
+  */
+void TimelineView::setModel(QAbstractItemModel * model) {
+   if (this->model()) {
+      disconnect(this->model(), SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(updateGeometries()));
+   }
+   QAbstractItemView::setModel(model);
+   rowHeader->setModel(model);
+   if (model) {
+      connect(model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(updateGeometries()));
+   }
+   updateGeometries();
+}
+
+/** The \a rect gets converted to a range of rows and frames, clamped to the
+  * existing ones.
+  */
+void TimelineView::setSelection(QRect const & rect, QItemSelectionModel::SelectionFlags command) {
+   if (!model()) {
+      return;
+   }
+   const int rows = model()->rowCount(rootIndex());
+   const int columns = model()->columnCount(rootIndex());
+   if (rows == 0 || columns == 0) {
+      return;
+   }
+   const QRect area = rect.normalized();
+   const QModelIndex topLeft = model()->index(qBound(0, rowAt(area.top()), rows-1),
+                                              qBound(0, columnAt(area.left()), columns-1),
+                                              rootIndex());
+   const QModelIndex bottomRight = model()->index(qBound(0, rowAt(area.bottom()), rows-1),
+                                                  qBound(0, columnAt(area.right()), columns-1),
+                                                  rootIndex());
+   selectionModel()->select(QItemSelection(topLeft, bottomRight), command);
+}
+
+/** Positive levels are the width of a frame in pixels, lower levels halve the
+  * width with each step, so level 0 shows two frames per pixel.
+  */
+void TimelineView::setZoom(int level) {
+   frameWidth = level>0 ? qreal(level) : qPow(2.0, level-1);
+   updateGeometries();
+   viewport()->update();
+}
+
+/** The scroll ranges are derived from the row count and the frame width, no per
+  * column state is needed.
+  */
+void TimelineView::updateGeometries() {
+   const int headerWidth = model() ? rowHeader->sizeHint().width() : 0;
+   setViewportMargins(headerWidth, 0, 0, 0);
+   const QRect geometry = viewport()->geometry();
+   rowHeader->setGeometry(geometry.left()-headerWidth, geometry.top(), headerWidth, geometry.height());
+
+   const int rows = model() ? model()->rowCount(rootIndex()) : 0;
+   const int columns = model() ? model()->columnCount(rootIndex()) : 0;
+   horizontalScrollBar()->setSingleStep(qMax(1, qFloor(frameWidth)));
+   horizontalScrollBar()->setPageStep(viewport()->width());
+   horizontalScrollBar()->setRange(0, qMax(0, frameLeft(columns)-viewport()->width()));
+   verticalScrollBar()->setSingleStep(rowHeight);
+   verticalScrollBar()->setPageStep(viewport()->height());
+   verticalScrollBar()->setRange(0, qMax(0, rows*rowHeight-viewport()->height()));
+   rowHeader->setOffset(verticalOffset());
+
+   QAbstractItemView::updateGeometries();
+}
+
+QHeaderView * TimelineView::verticalHeader() const {
+   return rowHeader;
+}
+
+int TimelineView::verticalOffset() const {
+   return verticalScrollBar()->value();
+}
+
+/** Frames narrower than a pixel still get a rectangle one pixel wide.
+  */
+QRect TimelineView::visualRect(QModelIndex const & index) const {
+   if (!index.isValid()) {
+      return QRect();
+   }
+   const int left = frameLeft(index.column());
+   const int right = frameLeft(index.column()+1);
+   return QRect(left - horizontalOffset(),
+                index.row()*rowHeight - verticalOffset(),
+                qMax(1, right-left),
+                rowHeight);
+}
+
+/** The region is clipped to the viewport, so huge selections don't create huge
+  * regions.
+  */
+QRegion TimelineView::visualRegionForSelection(QItemSelection const & selection) const {
+   QRegion region;
+   foreach (QItemSelectionRange const & range, selection) {
+      const QRect rect = QRect(visualRect(range.topLeft()).topLeft(),
+                               visualRect(range.bottomRight()).bottomRight());
+      region += rect.intersected(viewport()->rect());
+   }
+   return region;
+}
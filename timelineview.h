@@ -0,0 +1,89 @@
+#ifndef TIMELINEVIEW_H
+#define TIMELINEVIEW_H
+
+#include <QtGui/QAbstractItemView>
+#include "types.h"
+
+class QHeaderView;
+
+/// A view showing the objects of a Category as rows of box spans over time.
+/** Unlike a QTableView the view doesn't keep any per column state and doesn't
+  * paint cell by cell. Only the visible rows get painted and for each of them
+  * the runs of equally typed boxes within the visible frames get requested from
+  * the Object and drawn as spans, so the painting cost depends on the number of
+  * runs instead of the number of frames. The width of a frame can be smaller
+  * than a pixel, so even long videos fit into the view.
+  * The selection and keyboard navigation behave like the ones of a QTableView.
+  */
+class TimelineView : public QAbstractItemView {
+
+   Q_OBJECT
+
+public:
+   /// Default c'tor.
+   explicit TimelineView(QWidget * parent = 0);
+   /// Sets the \a model and connects the row header to it.
+   virtual void setModel(QAbstractItemModel * model);
+   /// Returns the header showing the object names.
+   QHeaderView * verticalHeader() const;
+   /// Sets the zoom \a level.
+   void setZoom(int level);
+   /// Returns the rectangle on the viewport occupied by the item at \a index.
+   virtual QRect visualRect(QModelIndex const & index) const;
+   /// Scrolls the view to make the item at \a index visible according to the \a hint.
+   virtual void scrollTo(QModelIndex const & index, ScrollHint hint = EnsureVisible);
+   /// Returns the index of the item at the viewport coordinates \a point.
+   virtual QModelIndex indexAt(QPoint const & point) const;
+
+public slots:
+   /// Resets the internal state after the model got reset.
+   virtual void reset();
+
+protected:
+   /// Returns the index the cursor moves to for the \a cursorAction.
+   virtual QModelIndex moveCursor(CursorAction cursorAction, Qt::KeyboardModifiers modifiers);
+   /// Returns the horizontal scroll offset in pixels.
+   virtual int horizontalOffset() const;
+   /// Returns the vertical scroll offset in pixels.
+   virtual int verticalOffset() const;
+   /// Items are never hidden.
+   virtual bool isIndexHidden(QModelIndex const & index) const;
+   /// Selects all items within \a rect according to the \a command.
+   virtual void setSelection(QRect const & rect, QItemSelectionModel::SelectionFlags command);
+   /// Returns the region on the viewport covered by the \a selection.
+   virtual QRegion visualRegionForSelection(QItemSelection const & selection) const;
+   /// Paints the visible rows.
+   virtual void paintEvent(QPaintEvent * event);
+   /// Scrolls the viewport and the row header.
+   virtual void scrollContentsBy(int dx, int dy);
+
+protected slots:
+   /// Repaints only the rows between \a topLeft and \a bottomRight.
+   virtual void dataChanged(QModelIndex const & topLeft, QModelIndex const & bottomRight);
+   /// Adapts the scroll ranges to the inserted rows.
+   virtual void rowsInserted(QModelIndex const & parent, int start, int end);
+   /// Updates the scroll ranges and the geometry of the row header.
+   virtual void updateGeometries();
+
+private:
+   QHeaderView * rowHeader; ///< Header showing the object names
+   qreal frameWidth;        ///< Width of one frame in pixels
+   int rowHeight;           ///< Height of one row in pixels
+
+   /// Returns the left border of the \a frame in content coordinates.
+   int frameLeft(int frame) const;
+   /// Returns the frame at the viewport coordinate \a x, which may be out of range.
+   int columnAt(int x) const;
+   /// Returns the row at the viewport coordinate \a y, which may be out of range.
+   int rowAt(int y) const;
+   /// Paints the \a run into the row starting at \a top.
+   void paintRun(QPainter & painter, BBoxRun const & run, int top) const;
+   /// Returns the hard coded colors
+   static QColor color(BBox::Type type, bool light=false);
+
+private slots:
+   /// Makes the given \a row current, keeping the current frame.
+   void selectRow(int row);
+};
+
+#endif // TIMELINEVIEW_H
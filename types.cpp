@@ -1,5 +1,8 @@
 #include "types.h"
 #include <QtXml/QDomElement>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 /** The type is initialised to #NULLTYPE, the other members are set to alike
   * values
@@ -30,6 +33,26 @@ bool BBox::operator==(BBox const & bbox) const {
    return (framenumber == bbox.framenumber);
 }
 
+PackedBBox::PackedBBox() :
+   rect(QRect()),
+   framenumber(-1),
+   type(BBox::NULLTYPE)
+{
+}
+
+/** The objectID of the \a bbox gets dropped.
+  */
+PackedBBox::PackedBBox(BBox const & bbox) :
+   rect(bbox.rect),
+   framenumber(bbox.framenumber),
+   type(bbox.type)
+{
+}
+
+BBox PackedBBox::unpack(int objectID) const {
+   return BBox(framenumber, rect, objectID, BBox::Type(type));
+}
+
 
 
 /** @relates BBox
@@ -52,6 +75,59 @@ BBox interpolate(int framenumber, BBox const & bboxA, BBox const & bboxB) {
                BBox::VIRTUAL);
 }
 
+/** @relates BBox
+  * The geometries of all frames between the two boxes get computed in one pass,
+  * so \a rects has to hold bboxB.framenumber-bboxA.framenumber-1 elements. The
+  * results are identical to the ones of interpolate(int framenumber, BBox const
+  * & bboxA, BBox const & bboxB), with SSE2 the four coordinates get blended and
+  * rounded at once, replicating qRound() for negative values as well.
+  * @note This only holds as long as the compiler doesn't contract the scalar
+  * products and sums into FMA instructions, so TrackIt.pro builds with
+  * -ffp-contract=off.
+  */
+void interpolateSegment(BBox const & bboxA, BBox const & bboxB, QRect * rects) {
+   const int n = bboxB.framenumber-bboxA.framenumber-1;
+   const qreal span = qreal(bboxB.framenumber-bboxA.framenumber);
+#ifdef __SSE2__
+   const __m128d xyA = _mm_set_pd(bboxA.rect.y(), bboxA.rect.x());
+   const __m128d whA = _mm_set_pd(bboxA.rect.height(), bboxA.rect.width());
+   const __m128d xyB = _mm_set_pd(bboxB.rect.y(), bboxB.rect.x());
+   const __m128d whB = _mm_set_pd(bboxB.rect.height(), bboxB.rect.width());
+   const __m128d zero = _mm_setzero_pd();
+   const __m128d half = _mm_set1_pd(0.5);
+   const __m128d one = _mm_set1_pd(1.0);
+   int coords[4];
+   for (int j=0; j<n; ++j) {
+      const qreal beta = qreal(j+1)/span;
+      const __m128d betas = _mm_set1_pd(beta);
+      const __m128d alphas = _mm_set1_pd(1.0-beta);
+      __m128i rounded[2];
+      for (int k=0; k<2; ++k) {
+         const __m128d d = k==0 ? _mm_add_pd(_mm_mul_pd(alphas, xyA), _mm_mul_pd(betas, xyB))
+                                : _mm_add_pd(_mm_mul_pd(alphas, whA), _mm_mul_pd(betas, whB));
+         // qRound: d >= 0.0 ? int(d + 0.5) : int(d - int(d-1) + 0.5) + int(d-1)
+         const __m128i positive = _mm_cvttpd_epi32(_mm_add_pd(d, half));
+         const __m128i offset = _mm_cvttpd_epi32(_mm_sub_pd(d, one));
+         const __m128i negative = _mm_add_epi32(_mm_cvttpd_epi32(_mm_add_pd(_mm_sub_pd(d, _mm_cvtepi32_pd(offset)), half)), offset);
+         // move the 64 bit comparison results into the two lower 32 bit lanes
+         const __m128i mask = _mm_shuffle_epi32(_mm_castpd_si128(_mm_cmpge_pd(d, zero)), _MM_SHUFFLE(3, 3, 2, 0));
+         rounded[k] = _mm_or_si128(_mm_and_si128(mask, positive), _mm_andnot_si128(mask, negative));
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(coords), _mm_unpacklo_epi64(rounded[0], rounded[1]));
+      rects[j] = QRect(coords[0], coords[1], coords[2], coords[3]);
+   }
+#else
+   for (int j=0; j<n; ++j) {
+      const qreal beta = qreal(j+1)/span;
+      const qreal alpha = 1.0-beta;
+      rects[j] = QRect(qRound(alpha*bboxA.rect.x() + beta*bboxB.rect.x()),
+                       qRound(alpha*bboxA.rect.y() + beta*bboxB.rect.y()),
+                       qRound(alpha*bboxA.rect.width() + beta*bboxB.rect.width()),
+                       qRound(alpha*bboxA.rect.height() + beta*bboxB.rect.height()));
+   }
+#endif
+}
+
 /** @relates BBox
   * Convenience function returning a list of BBoxes interpolated between frameStart and frameEnd.
   * (BBoxA and BBoxB are not part of the returned list!) (fixme: function not tested yet)
@@ -60,6 +136,17 @@ QList<BBox> interpolate(int frameStart, int frameEnd, BBox const & bboxA, BBox c
    if (frameStart+1 >= frameEnd){
       return QList<BBox>();
    }
+   else if (frameStart==bboxA.framenumber && frameEnd==bboxB.framenumber){
+     // the whole segment, use the batch kernel
+     QVector<QRect> rects(frameEnd-frameStart-1);
+     interpolateSegment(bboxA, bboxB, rects.data());
+     QList<BBox> l;
+     l.reserve(rects.size());
+     for (int i=0; i<rects.size(); i++){
+         l.push_back(BBox(frameStart+1+i, rects.at(i), bboxA.objectID, BBox::VIRTUAL));
+     }
+     return l;
+   }
    else{
      QList<BBox> l;
      for (int i=frameStart+1; i<frameEnd; i++){
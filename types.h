@@ -5,6 +5,7 @@
 #include <QtCore/QRect>
 #include <QtCore/QSize>
 #include <QtCore/QList>
+#include <QtCore/QVector>
 
 class Object;
 class QDomElement;
@@ -39,10 +40,41 @@ struct BBox {
    bool operator==(BBox const & bbox) const;
 };
 
+/// Compact form of a BBox as it is stored inside an Object.
+/** The objectID is omitted since it is the ID of the storing object and the
+  * type is packed into a single byte, so a sorted QVector of these boxes takes
+  * only a fraction of the memory of a QMap of \ref BBox "BBox"es.
+  */
+struct PackedBBox {
+   QRect rect;         ///< Geometry of the bounding box
+   qint32 framenumber; ///< Number of the frame the bounding box appears
+   quint8 type;        ///< BBox::Type of the bounding box
+
+   /// Constructs a NULL bounding box.
+   PackedBBox();
+   /// Packs the \a bbox.
+   explicit PackedBBox(BBox const & bbox);
+   /// Returns the unpacked box belonging to the object with the given \a objectID.
+   BBox unpack(int objectID) const;
+};
+
+/// A span of consecutive frames in which an object has boxes of the same type.
+/** Frames not covered by any run have no box, i.e. BBox::NULLTYPE.
+  */
+struct BBoxRun {
+   int first;       ///< First framenumber of the run
+   int last;        ///< Last framenumber of the run
+   BBox::Type type; ///< Type of all boxes in the run
+};
+
 /// Retruns a box interpolated between two specified boxes using the framenumbers.
 /** @relates BBox */
 BBox interpolate(int framenumber, BBox const & bboxA, BBox const & bboxB);
 
+/// Writes the geometries of all boxes between \a bboxA and \a bboxB to \a rects.
+/** @relates BBox */
+void interpolateSegment(BBox const & bboxA, BBox const & bboxB, QRect * rects);
+
 /// Returns a list of interpolated BBoxes between specified framenumbers..
 /** @relates BBox */
 QList<BBox> interpolate(int frameStart, int frameEnd, BBox const & bboxA, BBox const & bboxB);
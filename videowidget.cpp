@@ -1,6 +1,9 @@
 #include "videowidget.h"
+#include <cstring>
 #include <iostream>
+#include <QtCore/QFileInfo>
 #include <QtCore/QTimer>
+#include <QtCore/QtAlgorithms>
 #include <QtGui/QFileDialog>
 #include <QtGui/QFormLayout>
 #include <QtGui/QLabel>
@@ -11,7 +14,9 @@
 #include <opencv2/core/core.hpp>
 #include <GL/glext.h>
 #include "datawidget.h"
+#include "framedecoder.h"
 #include "object.h"
+#include "objectstore.h"
 
 
 
@@ -33,24 +38,86 @@ VideoWidget::VideoWidget(DataWidget * data, QWidget * parent) :
    zoom(1.0),
    texCoords(QSizeF(1.0, 1.0)),
    currentTexture(0),
+   textureTarget(GL_TEXTURE_2D),
+   mipmapped(true),
+   pixelBufferIndex(0),
    currentFrame(0),
    selectedObj(NULL),
    selectedBBox(NULL),
    hitArea(NONE),
+   bboxesDirty(true),
+   bboxGridDirty(true),
+   boxBuffer(0),
+   boxBatchDirty(true),
+   centerlineID(-1),
+   centerBuffer(0),
+   centerlineDirty(true),
+   centerPatchBegin(0),
+   centerPatchEnd(0),
+   shownFrame(-1),
    data(data),
-   cacheEnabled(true),
-   cacheSize(45)
+   decoderStatsDirty(false),
+   cacheStatsDirty(false),
+   playStartFrame(0),
+   fCache(256),
+   cacheEnabled(true)
 {
    setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+   decoder = new FrameDecoder(this);
+   connect(decoder, SIGNAL(frameDecoded(int)), this, SLOT(frameDecoded(int)));
    timer = new QTimer(this);
-   connect(timer, SIGNAL(timeout()), this, SLOT(showNextFrame()));
+   connect(timer, SIGNAL(timeout()), this, SLOT(playbackTick()));
+   statsTimer = new QTimer(this);
+   statsTimer->setSingleShot(true);
+   statsTimer->setInterval(250);
+   connect(statsTimer, SIGNAL(timeout()), this, SLOT(emitStats()));
+   connect(objectStore, SIGNAL(dataChanged(int,int,int)), this, SLOT(objectChanged(int)));
    setMouseTracking(true);
 }
 
-/** The framerate is obtained from the openCV \ref capture
+/** The frame is shown only if it's still the \ref currentFrame, all other
+  * frames stay in the decoder's ring until they are requested.
+  */
+void VideoWidget::frameDecoded(int frame) {
+   if (frame == currentFrame && shownFrame != currentFrame) {
+      cv::Mat mat;
+      if (decoder->fetchFrame(frame, mat)) {
+         showFrame(frame, mat);
+      }
+   }
+   updateDecoderStats();
+}
+
+/** Only the statistics that changed since the last time get emitted.
+  */
+void VideoWidget::emitStats() {
+   if (decoderStatsDirty) {
+      decoderStatsDirty = false;
+      emit decoderStatsChanged(tr("Decode-ahead: %1/%2 frames, dropped: %3")
+                               .arg(decoder->getDepth())
+                               .arg(decoder->getRingSize())
+                               .arg(decoder->getDroppedFrames()));
+   }
+   if (cacheStatsDirty) {
+      cacheStatsDirty = false;
+      if (cacheEnabled) {
+         emit cacheStatsChanged(tr("Cache: %1/%2 MB, hits: %3, misses: %4, evicted: %5")
+                                .arg(fCache.getUsage()/1024)
+                                .arg(fCache.getBudget())
+                                .arg(fCache.getHits())
+                                .arg(fCache.getMisses())
+                                .arg(fCache.getEvictions()));
+      }
+      else {
+         emit cacheStatsChanged(tr("Cache disabled"));
+      }
+   }
+}
+
+/** The framerate is obtained from the \ref decoder
   */
 double VideoWidget::getFramerate() {
-   return capture.get(CV_CAP_PROP_FPS);
+   return decoder->getFramerate();
 }
 
 /** The corresponding object is retrieved from the DataWidget. The \ref
@@ -66,6 +133,7 @@ void VideoWidget::changeSelection(int id) {
       else {
          selectedBBox = NULL;
       }
+      boxBatchDirty = true;
       updateGL();
    }
 }
@@ -95,7 +163,7 @@ void VideoWidget::createBBox() {
    }
    else {
       // no box present
-      BBox * previousBBox = selectedObj->getBBoxPointer(currentFrame-1);
+      PackedBBox * previousBBox = selectedObj->getBBoxPointer(currentFrame-1);
       if (previousBBox) {
          // preceding box present
          selectedObj->addBBox(BBox(currentFrame,
@@ -138,7 +206,7 @@ void VideoWidget::createKeyBBox() {
    }
    else {
       // no box present
-      BBox * previousBBox = selectedObj->getPrecedingBBoxPointer(currentFrame);
+      PackedBBox * previousBBox = selectedObj->getPrecedingBBoxPointer(currentFrame);
       if (previousBBox) {
          // preceding box present
          selectedObj->addBBox(BBox(currentFrame,
@@ -166,6 +234,17 @@ void VideoWidget::initializeGL() {
    glEnable(GL_POINT_SMOOTH);
    glEnable(GL_LINE_SMOOTH);
    glLineStipple(1, 0xF0F0);
+   // the rows of the frames are tightly packed
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+   gl.resolve(context());
+   if (gl.pixelBufferObjects) {
+      gl.genBuffers(3, pixelBuffers);
+   }
+   // exactly sized textures, preferably with mipmaps
+   if (!gl.npotTextures && gl.rectangleTextures) {
+      textureTarget = GL_TEXTURE_RECTANGLE_ARB;
+   }
 
    glMatrixMode(GL_PROJECTION);
    glLoadIdentity();
@@ -174,43 +253,70 @@ void VideoWidget::initializeGL() {
    glLoadIdentity();
 }
 
-/** Internally a small QRect is created, moved to every handles position and
- * checked for containment of the \a pos
+/** The \ref bboxes get rerequested lazily, e.g. by the next click, so bulk
+  * changes don't cause a request for every single change. The \ref
+  * selectedBBox gets looked up again right away, as it points into the boxes of
+  * its object.
+  */
+void VideoWidget::invalidateData() {
+   bboxesDirty = true;
+   if (selectedObj) {
+      selectedBBox = selectedObj->getBBoxPointer(currentFrame);
+   }
+}
+
+/** The centerline geometry gets rebuilt with the next repaint. Inserting or
+  * deleting boxes moves the boxes of an object in memory, so the \ref
+  * selectedBBox gets looked up again if the selected object changed. Changes of
+  * other objects get reported by the ObjectStore as well and are ignored.
+  */
+void VideoWidget::objectChanged(int objectID) {
+   if (objectID == centerlineID) {
+      centerlineDirty = true;
+   }
+   if (selectedObj && objectID == selectedObj->getID()) {
+      selectedBBox = selectedObj->getBBoxPointer(currentFrame);
+   }
+}
+
+/** The handles are squares of 9x9 screen pixels centered on the corners and
+ * the centers of the edges. Instead of testing each handle, the position gets
+ * classified into horizontal and vertical bands once.
  * \note The \a pos has to be in video coordinates!
  */
 VideoWidget::Hitarea VideoWidget::isHit(QRect const & rect, QPoint const & pos) const {
-   QRect handle(QPoint(0, 0), QSize(9, 9)/zoom);
-
-   handle.moveCenter(rect.topLeft());
-   if (handle.contains(pos)) {
+   // same extent and rounding as a QRect of this size moved to the handle
+   const int extent = (QSize(9, 9)/zoom).width()-1;
+   const int offset = extent/2;
+   const bool left = pos.x() >= rect.left()-offset && pos.x() <= rect.left()-offset+extent;
+   const bool right = pos.x() >= rect.right()-offset && pos.x() <= rect.right()-offset+extent;
+   const bool centerX = pos.x() >= rect.center().x()-offset && pos.x() <= rect.center().x()-offset+extent;
+   const bool top = pos.y() >= rect.top()-offset && pos.y() <= rect.top()-offset+extent;
+   const bool bottom = pos.y() >= rect.bottom()-offset && pos.y() <= rect.bottom()-offset+extent;
+   const bool centerY = pos.y() >= rect.center().y()-offset && pos.y() <= rect.center().y()-offset+extent;
+
+   if (top && left) {
       return TOPLEFT;
    }
-   handle.moveCenter(rect.topRight());
-   if (handle.contains(pos)) {
+   if (top && right) {
       return TOPRIGHT;
    }
-   handle.moveCenter(rect.bottomLeft());
-   if (handle.contains(pos)) {
+   if (bottom && left) {
       return BOTTOMLEFT;
    }
-   handle.moveCenter(rect.bottomRight());
-   if (handle.contains(pos)) {
+   if (bottom && right) {
       return BOTTOMRIGHT;
    }
-   handle.moveCenter(QPoint(rect.center().x(), rect.top()));
-   if (handle.contains(pos)) {
+   if (top && centerX) {
       return TOP;
    }
-   handle.moveCenter(QPoint(rect.left(), rect.center().y()));
-   if (handle.contains(pos)) {
+   if (left && centerY) {
       return LEFT;
    }
-   handle.moveCenter(QPoint(rect.right(), rect.center().y()));
-   if (handle.contains(pos)) {
+   if (right && centerY) {
       return RIGHT;
    }
-   handle.moveCenter(QPoint(rect.center().x(), rect.bottom()));
-   if (handle.contains(pos)) {
+   if (bottom && centerX) {
       return BOTTOM;
    }
    if (rect.contains(pos)) {
@@ -258,6 +364,10 @@ void VideoWidget::mouseMoveEvent(QMouseEvent * event) {
          updateCursor();
          break;
       }
+      if (hitArea) {
+         selectedObj->invalidateInterpolation(selectedBBox->framenumber);
+         patchCenterline(*selectedBBox);
+      }
    }
    event->ignore();
    if (hitArea) {
@@ -297,13 +407,18 @@ void VideoWidget::mousePressEvent(QMouseEvent * event) {
       }
 
       if (!hitArea) {
-         bboxes = data->getBBoxes(currentFrame);
-         int i = bboxes.size();
-         bool hit = false;
-         while (!hit && i>0) {
-            hit = bboxes.at(--i).rect.contains(hitPos);
+         if (bboxesDirty) {
+            bboxes = data->getBBoxes(currentFrame);
+            bboxesDirty = false;
+            bboxGridDirty = true;
+            boxBatchDirty = true;
          }
-         if (hit) {
+         if (bboxGridDirty) {
+            bboxGrid.build(bboxes);
+            bboxGridDirty = false;
+         }
+         const int i = bboxGrid.boxAt(hitPos);
+         if (i >= 0) {
             selectedObj = data->getObject(bboxes.at(i).objectID);
             selectedBBox = selectedObj->getBBoxPointer(currentFrame);
             emit selectionChanged(bboxes.at(i).objectID);
@@ -321,20 +436,30 @@ void VideoWidget::mousePressEvent(QMouseEvent * event) {
    updateGL();
 }
 
-/** \ref hitArea is set to \ref NONE and created boxes get normalized
+/** \ref hitArea is set to \ref NONE and created boxes get normalized. As boxes
+ * get changed in place while dragging, the final geometry gets reported to the
+ * ObjectStore once the drag ends.
  */
 void VideoWidget::mouseReleaseEvent(QMouseEvent * event) {
+   const bool dragged = (hitArea != NONE);
    hitArea = NONE;
    // correct wrong BBs
    if (selectedBBox && !selectedBBox->rect.isValid()) {
       selectedBBox->rect = selectedBBox->rect.normalized();
+      selectedObj->invalidateInterpolation(selectedBBox->framenumber);
+   }
+   if (dragged && selectedBBox) {
+      objectStore->notifyDataChanged(selectedObj->getID(), selectedBBox->framenumber, selectedBBox->framenumber);
    }
    event->accept();
 }
 
 /** If the video doesn't exists nothing happens, else it is opened without any
-  * further prompt into the openCV \ref capture and a VideofileInfo gets
+  * further prompt by the \ref decoder and a VideofileInfo gets
   * screated and sent to the DataWidget.
+  * The KeyframeIndex of the video is loaded from a \c .kfi file next to the
+  * data file (or the video if there is no data file yet). If there is none or
+  * the video changed, the index gets built and saved there.
   */
 void VideoWidget::openRequest(QString openFilename) {
    QString filename = openFilename;
@@ -349,26 +474,35 @@ void VideoWidget::openRequest(QString openFilename) {
       }
    }
 
-   capture.open(filename.toStdString());
+   QFileInfo videoInfo(filename);
+   const QString dataFilename = data->getFilename();
+   const QString indexFilename = (dataFilename.isEmpty() ? videoInfo.absolutePath()
+                                                         : QFileInfo(dataFilename).absolutePath())
+                                 +'/'+videoInfo.fileName()+".kfi";
+   KeyframeIndex index;
+   if (!index.load(indexFilename, filename) && index.build(filename)) {
+      index.save(indexFilename);
+   }
 
-   if (!capture.isOpened()) {
+   play(false);
+   if (!decoder->open(filename, index)) {
       QMessageBox::warning(this,
                            tr("Unable to open video"),
                            tr("The file\n\"")+filename+tr("\"\ncouldn't be opened as a video!"));
       return;
    }
 
-   videoSize.setWidth(capture.get(CV_CAP_PROP_FRAME_WIDTH));
-   videoSize.setHeight(capture.get(CV_CAP_PROP_FRAME_HEIGHT));
+   videoSize = decoder->getFrameSize();
    resizeTexture();
    setZoom(1.0);
-   emit maxFramesChanged(capture.get(CV_CAP_PROP_FRAME_COUNT));
+   emit maxFramesChanged(decoder->getFramecount());
 
    data->setVFInfo(VideofileInfo(filename.section('/', -1),
-                                 capture.get(CV_CAP_PROP_FRAME_COUNT),
+                                 decoder->getFramecount(),
                                  videoSize));
    // Just to make sure everything updates
    currentFrame = -1;
+   shownFrame = -1;
    clearFrameCache();
    emit currentFrameChanged(1);
    seek(0);
@@ -395,8 +529,8 @@ void VideoWidget::openVideoFile() {
 /** First the current video frame gets rendered, then the currently visible
  * bounding boxes and the selected object.
  * \sa void renderCurrentFrame() const
- * \sa void renderBBox(BBox const & bbox, bool active) const
- * \sa void renderSelectedObject() const
+ * \sa void renderBoxBatch()
+ * \sa void renderSelectedObject()
  */
 void VideoWidget::paintGL() {
    glMatrixMode(GL_PROJECTION);
@@ -407,23 +541,47 @@ void VideoWidget::paintGL() {
 
    glLoadIdentity();
    glOrtho(0.5f, videoSize.width()+0.5f, videoSize.height()+0.5f, 0.5f, -5.0f, 5.0f);
-   foreach (BBox const & bbox, bboxes) {
-      if (!selectedObj || bbox.objectID != selectedObj->getID()) {
-         renderBBox(bbox);
-      }
-   }
-
+   renderBoxBatch();
    renderSelectedObject();
 }
 
+/** Only the CPU copy gets changed here, the changed range is uploaded with the
+  * next repaint. This is used while dragging a box, which changes the box in
+  * place without ObjectStore::dataChanged() being emitted.
+  */
+void VideoWidget::patchCenterline(PackedBBox const & bbox) {
+   if (centerlineDirty || !selectedObj || centerlineID != selectedObj->getID()) {
+      return;
+   }
+   QVector<int>::const_iterator it = qBinaryFind(centerFrames.constBegin(), centerFrames.constEnd(), bbox.framenumber);
+   if (it == centerFrames.constEnd()) {
+      centerlineDirty = true;
+      return;
+   }
+   const int i = it-centerFrames.constBegin();
+   centerVertices[2*i] = bbox.rect.center().x();
+   centerVertices[2*i+1] = bbox.rect.center().y();
+   if (centerPatchBegin < centerPatchEnd) {
+      centerPatchBegin = qMin(centerPatchBegin, i);
+      centerPatchEnd = qMax(centerPatchEnd, i+1);
+   }
+   else {
+      centerPatchBegin = i;
+      centerPatchEnd = i+1;
+   }
+}
+
 /** The \ref timer gets started with a interval according to the videos FPS and
  * \ref playToggled gets emitted with true.
- * \note the \ref timer timeout signal is connected to showNextFrame()
+ * \note the \ref timer timeout signal is connected to playbackTick()
  */
 void VideoWidget::play(bool play) {
-   if (capture.isOpened()) {
+   if (decoder->isOpened()) {
       if (play) {
-         timer->start(1000.0/capture.get(CV_CAP_PROP_FPS));
+         playStartFrame = currentFrame;
+         playTime.start();
+         decoder->resetStatistics();
+         timer->start(1000.0/decoder->getFramerate());
       }
       else {
          timer->stop();
@@ -435,6 +593,21 @@ void VideoWidget::play(bool play) {
    }
 }
 
+/** The frame to show is determined by the time elapsed since the playback
+  * started, so frames get skipped when the decoder falls behind instead of
+  * slowing the playback down. The playback stops at the last frame.
+  */
+void VideoWidget::playbackTick() {
+   const int lastFrame = decoder->getFramecount()-1;
+   const int frame = qMin(playStartFrame + int(playTime.elapsed()*decoder->getFramerate()/1000), lastFrame);
+   if (frame > currentFrame) {
+      seek(frame);
+   }
+   if (currentFrame >= lastFrame) {
+      play(false);
+   }
+}
+
 /** The color gets chosen according to \a active
  */
 void VideoWidget::renderBBox(BBox const & bbox, bool active) const {
@@ -492,14 +665,52 @@ void VideoWidget::renderBBox(BBox const & bbox, bool active) const {
    glDisableClientState(GL_VERTEX_ARRAY);
 }
 
+/** The boxes get drawn from the \ref boxVertices with two calls, the black
+  * outlines first and the colored lines on top. The vertices are rebuilt only
+  * if the visible boxes or the selection changed.
+  */
+void VideoWidget::renderBoxBatch() {
+   if (boxBatchDirty) {
+      updateBoxBatch();
+   }
+   if (boxVertices.isEmpty()) {
+      return;
+   }
+
+   char const * base = reinterpret_cast<char const *>(boxVertices.constData());
+   if (gl.bufferObjects) {
+      gl.bindBuffer(GL_ARRAY_BUFFER, boxBuffer);
+      base = NULL;
+   }
+   glEnableClientState(GL_VERTEX_ARRAY);
+   glVertexPointer(2, GL_FLOAT, sizeof(BoxVertex), base);
+
+   //render outlines
+   glColor4f(0.0f, 0.0f, 0.0f, 0.5f);
+   glLineWidth(3.5f);
+   glDrawArrays(GL_LINES, 0, boxVertices.size());
+
+   //render boxes
+   glEnableClientState(GL_COLOR_ARRAY);
+   glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(BoxVertex), base+2*sizeof(GLfloat));
+   glLineWidth(1.5f);
+   glDrawArrays(GL_LINES, 0, boxVertices.size());
+   glDisableClientState(GL_COLOR_ARRAY);
+   glDisableClientState(GL_VERTEX_ARRAY);
+
+   if (gl.bufferObjects) {
+      gl.bindBuffer(GL_ARRAY_BUFFER, 0);
+   }
+}
+
 /** The object is represented by a white line connecting the center of all of
   * its BBoxes. The selected box is also rendered as a fat box with visible
   * handles and a white point at its center to clarify its position on the white
   * line.
-  * \sa void renderCenterline() const
+  * \sa void renderCenterline()
   * \sa void renderBBox(BBox const & bbox, bool active = false) const
   */
-void VideoWidget::renderSelectedObject() const {
+void VideoWidget::renderSelectedObject() {
    if (!selectedObj) {
       return;
    }
@@ -525,51 +736,56 @@ void VideoWidget::renderSelectedObject() const {
    }
 }
 
-/** The centerline connects the centers of all bounding boxes to represent an object
+/** The centerline connects the centers of all bounding boxes to represent an object.
+  * Its geometry is only rebuilt if the selection changed or the selected object
+  * got reported by ObjectStore::dataChanged(), moving its box just updates a single center.
   */
-void VideoWidget::renderCenterline() const {
-   int prevFrameNumber;
-   QPoint prevCenter;
-   // Paint Centerlines:
+void VideoWidget::renderCenterline() {
+   if (centerlineID != selectedObj->getID()) {
+      centerlineID = selectedObj->getID();
+      centerlineDirty = true;
+   }
+   if (centerlineDirty) {
+      updateCenterline();
+   }
+   else if (gl.bufferObjects && centerPatchBegin < centerPatchEnd) {
+      gl.bindBuffer(GL_ARRAY_BUFFER, centerBuffer);
+      gl.bufferSubData(GL_ARRAY_BUFFER, 2*centerPatchBegin*sizeof(GLfloat),
+                       2*(centerPatchEnd-centerPatchBegin)*sizeof(GLfloat),
+                       centerVertices.constData()+2*centerPatchBegin);
+      gl.bindBuffer(GL_ARRAY_BUFFER, 0);
+   }
+   centerPatchBegin = centerPatchEnd = 0;
+
+   GLfloat const * base = centerVertices.constData();
+   if (gl.bufferObjects) {
+      gl.bindBuffer(GL_ARRAY_BUFFER, centerBuffer);
+      base = NULL;
+   }
+   glEnableClientState(GL_VERTEX_ARRAY);
+   glVertexPointer(2, GL_FLOAT, 0, base);
+
    // set color for background lines
    glColor4f(0.0f, 0.0f, 0.0f, 0.5f);
    glLineWidth(3.5f);
-
    for (int pass=0; pass<2; ++pass) {
       // paint solid lines
-      prevFrameNumber = selectedObj->firstBBox().framenumber;
-      prevCenter = selectedObj->firstBBox().rect.center();
-      glBegin(GL_LINES);
-      foreach (BBox const & bbox, selectedObj->getBBoxes()) {
-         if (bbox.type==BBox::SINGLE && bbox.framenumber==prevFrameNumber+1) {
-            glVertex2f(prevCenter.x(), prevCenter.y());
-            glVertex2f(bbox.rect.center().x(), bbox.rect.center().y());
-         }
-         prevFrameNumber = bbox.framenumber;
-         prevCenter = bbox.rect.center();
-      }
-      glEnd();
+      glDrawElements(GL_LINES, solidIndices.size(), GL_UNSIGNED_INT, solidIndices.constData());
 
       // paint stippled lines
-      prevFrameNumber = selectedObj->firstBBox().framenumber;
-      prevCenter = selectedObj->firstBBox().rect.center();
       glEnable(GL_LINE_STIPPLE);
-      glBegin(GL_LINES);
-      foreach (BBox const & bbox, selectedObj->getBBoxes()) {
-         if (bbox.type==BBox::KEYBOX) {
-            glVertex2f(prevCenter.x(), prevCenter.y());
-            glVertex2f(bbox.rect.center().x(), bbox.rect.center().y());
-         }
-         prevFrameNumber = bbox.framenumber;
-         prevCenter = bbox.rect.center();
-      }
-      glEnd();
+      glDrawElements(GL_LINES, stippledIndices.size(), GL_UNSIGNED_INT, stippledIndices.constData());
       glDisable(GL_LINE_STIPPLE);
 
       // set color for foreground lines (2nd pass)
       glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
       glLineWidth(1.5f);
    }
+
+   glDisableClientState(GL_VERTEX_ARRAY);
+   if (gl.bufferObjects) {
+      gl.bindBuffer(GL_ARRAY_BUFFER, 0);
+   }
 }
 
 /** Since the frame is saved in a GL texture simply a view filling quad with the
@@ -578,7 +794,7 @@ void VideoWidget::renderCenterline() const {
   * texture coordinates don't reach to 1.0 but to \ref texCoords.
   */
 void VideoWidget::renderCurrentFrame() const {
-   glEnable(GL_TEXTURE_2D);
+   glEnable(textureTarget);
    glBegin(GL_QUADS);
    glTexCoord2f(0.0f, texCoords.height());
    glVertex2f(0.0f, 1.0f);
@@ -589,7 +805,7 @@ void VideoWidget::renderCurrentFrame() const {
    glTexCoord2f(0.0f, 0.0f);
    glVertex2f(0.0f, 0.0f);
    glEnd();
-   glDisable(GL_TEXTURE_2D);
+   glDisable(textureTarget);
 }
 
 /** Simply updates the viewport to the new \a width and \a height.
@@ -598,136 +814,73 @@ void VideoWidget::resizeGL(int width, int height) {
    glViewport(0, 0, width, height);
 }
 
-/** The width and height are powers of two to support legacy video systems.
- * The Coordinate of the loose edge of the actual image data is saved in \ref
- * texCoords for rendering.
+/** If the context supports textures of any size, the texture has exactly the
+ * size of the video. Only legacy video systems need the width and height to be
+ * powers of two, then the coordinate of the loose edge of the actual image data
+ * is saved in \ref texCoords for rendering. Rectangle textures are addressed in
+ * pixels, so \ref texCoords holds the video's size then. Mipmaps only get
+ * generated if the video is shown smaller than its resolution.
  */
 void VideoWidget::resizeTexture() {
-   const int widthPOT = getNearestPOT(videoSize.width());
-   const int heightPOT = getNearestPOT(videoSize.height());
-   texCoords = QSizeF(videoSize.width()/float(widthPOT), videoSize.height()/float(heightPOT));
+   if (textureTarget == GL_TEXTURE_RECTANGLE_ARB) {
+      textureSize = videoSize;
+      texCoords = QSizeF(videoSize);
+   }
+   else {
+      textureSize = gl.npotTextures ? videoSize
+                                    : QSize(getNearestPOT(videoSize.width()), getNearestPOT(videoSize.height()));
+      texCoords = QSizeF(videoSize.width()/float(textureSize.width()), videoSize.height()/float(textureSize.height()));
+   }
 
-   glEnable(GL_TEXTURE_2D);
+   glEnable(textureTarget);
    glDeleteTextures(1, &currentTexture);
    glGenTextures(1, &currentTexture);
-   glBindTexture(GL_TEXTURE_2D, currentTexture);
-   glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-   glTexImage2D(GL_TEXTURE_2D, 0, 3, widthPOT, heightPOT, 0, GL_BGR, GL_UNSIGNED_BYTE, 0);
-   glDisable(GL_TEXTURE_2D);
-}
-
-/** seek: loads frames to show into texture.
- * cacheSize frames before actual frame are cached to achieve better scrollback performance
- * This is where framecaching is done: it consists of 6 cases:
- * 1) cache is empty -> refill.
- * 2) the frame requested is in the cache -> just show.
- * 3) the frame is consecutively following the one in the cache (happens often)
- -> cache new one, delete smallest one.
- * 4) closer to the start than cache is big -> clear cache and refill from start.
- * 5) from new frame backward towards cache is the stuff..
- * 6) not in cache-> empty cache and refill
+   glBindTexture(textureTarget, currentTexture);
+   glTexParameteri(textureTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+   glTexImage2D(textureTarget, 0, 3, textureSize.width(), textureSize.height(), 0, GL_BGR, GL_UNSIGNED_BYTE, 0);
+   glDisable(textureTarget);
+   shownImage = cv::Mat();
+   setMipmapping(zoom < 1.0);
+}
+
+/** The frame is taken from the frame cache if possible, else it gets
+ * requested from the \ref decoder. If the decoder hasn't decoded it yet, the
+ * previous image stays visible until frameDecoded() delivers it, but the
+ * \ref currentFrame and the bounding boxes change immediately.
+ * Going back by a single frame requests it FrameDecoder::BACKWARD, so stepping
+ * backwards gets served from chunks decoded in the background.
  */
 void VideoWidget::seek(int frame) {
-   cv::Mat cvImage;
-   const int nextFrame = capture.get(CV_CAP_PROP_POS_FRAMES);
-   const int maxFrames = capture.get(CV_CAP_PROP_FRAME_COUNT);
-
    if (frame == currentFrame){
       updateGL();
       return;
    }
-   if ((frame < 0) || (frame >= maxFrames)) {
+   if ((frame < 0) || (frame >= decoder->getFramecount())) {
       play(false);
       return;
    }
 
-   //calculate memory usage:
-   if (!cacheEnabled) {
-      if (frame != nextFrame) {
-         capture.set(CV_CAP_PROP_POS_FRAMES, frame);
-      }
-
-      currentFrame = frame;
-      emit currentFrameChanged(currentFrame);
-
-      capture >> cvImage;
-      updateTexture(cvImage);
-
-      hitArea = NONE;
-      updateData();
-      updateGL();
-   }else{
-      int firstElementIdx = fCache.lowerBound(0).key();
-      int lastElementIdx = (fCache.end()-1).key();
-
-      // if cache is empty fill,
-      if (fCache.isEmpty()){
-         if (frame-cacheSize  < 0){
-            capture.set(CV_CAP_PROP_POS_FRAMES, 0);
-            for (int i=0; i<cacheSize; i++){
-               capture >> cvImage; // todo: refine into single line
-               fCache.insert(i,cvImage.clone());
-            }
-         }else{
-            capture.set(CV_CAP_PROP_POS_FRAMES, frame-cacheSize);
-            for (int i=frame-cacheSize; i<=frame; i++){
-               capture >> cvImage; // todo: refine into single line
-               fCache.insert(i,cvImage.clone());
-            }
-         }
-         updateTexture(fCache.value(frame));
-         // if cache is hit:
-      }else if (    (firstElementIdx <= frame)
-                    && (lastElementIdx >= frame)){
-         updateTexture(fCache.value(frame));
-         // if it's in cache+1 (happens often because +1 frame!):
-      }else if (frame == lastElementIdx+1){
-         // * load new frame, put it to last position of cache, delete the first in the cache
-         if(!(capture.get(CV_CAP_PROP_POS_FRAMES) == frame)){
-            capture.set(CV_CAP_PROP_POS_FRAMES, frame);
-         }
-         capture >> cvImage;
-         fCache.insert(frame, cvImage.clone());
-         updateTexture(fCache.value(frame));
-         fCache.remove(firstElementIdx);
-         // if too close to beginning to put everything in frame..
-      }else if (frame - cacheSize < 0){
-         // * delete cache and refill;
-         clearFrameCache();
-         seek(frame);
-         return;
-         // already some frames cached.....
-      }else if ((frame-cacheSize > firstElementIdx) &&
-                (frame-cacheSize < lastElementIdx)){
-         // delete frames from first frame to frame-cacheSize,
-         // set counter to last Cache Element+1 and add frames from there up to frame
-         if(!(capture.get(CV_CAP_PROP_POS_FRAMES) == lastElementIdx+1)){
-            capture.set(CV_CAP_PROP_POS_FRAMES, lastElementIdx+1);
-         }
-         for (int i=lastElementIdx+1; i<=frame; i++){
-            capture >> cvImage;
-            fCache.insert(i, cvImage.clone());
-         }
-         for (int i=firstElementIdx; i<frame-cacheSize; i++){
-            fCache.remove(i);   // < remove unneeded beginning of cache
-         }
-         updateTexture(fCache.value(frame));
+   // stepping back by one frame switches the decoder to the backward mode
+   const FrameDecoder::Direction direction = frame == currentFrame-1 ? FrameDecoder::BACKWARD
+                                                                     : FrameDecoder::FORWARD;
+   currentFrame = frame;
+   emit currentFrameChanged(currentFrame);
 
-         // totally not in cache, also old stuff not..
-      }else {
-         clearFrameCache();
-         seek(frame);
-         return;
+   cv::Mat cvImage;
+   if (cacheEnabled && fCache.lookup(frame, cvImage)) {
+      showFrame(frame, cvImage);
+      updateCacheStats();
+   }
+   else {
+      decoder->request(frame, direction);
+      if (decoder->fetchFrame(frame, cvImage)) {
+         showFrame(frame, cvImage);
       }
-      //std::cout << "Cachesize: " << fCache.size() << " elements. \n";
-      currentFrame=frame;
-      emit currentFrameChanged(currentFrame);
-      hitArea=NONE;
-      updateData();
-      updateGL();
+      updateDecoderStats();
    }
+
+   hitArea = NONE;
+   updateData();
 }
 
 /** If \ref autoZoom is set the zoom is adjusted, too.
@@ -743,10 +896,37 @@ void VideoWidget::setAvailableSize(QSize newSize) {
    }
 }
 
+/** Generating the mipmaps is a big part of each upload, but they are only
+  * needed when the video is shown smaller than its resolution. When enabled,
+  * the shown frame gets uploaded again to create them.
+  * \note Rectangle textures don't support mipmaps at all.
+  */
+void VideoWidget::setMipmapping(bool enabled) {
+   mipmapped = enabled;
+   makeCurrent();
+   glEnable(textureTarget);
+   glBindTexture(textureTarget, currentTexture);
+   if (textureTarget != GL_TEXTURE_RECTANGLE_ARB) {
+      glTexParameteri(textureTarget, GL_GENERATE_MIPMAP, enabled ? GL_TRUE : GL_FALSE);
+      glTexParameteri(textureTarget, GL_TEXTURE_MIN_FILTER, enabled ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+   }
+   else {
+      glTexParameteri(textureTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+   }
+   glDisable(textureTarget);
+   if (enabled && !shownImage.empty()) {
+      updateTexture(shownImage);
+   }
+   updateTextureStats();
+}
+
 /** Also emits signal \ref zoomChanged(float zoom)
   */
 void VideoWidget::setZoom(qreal newZoom) {
    zoom = qBound(0.1, newZoom, 2.0);
+   if (currentTexture && (zoom < 1.0) != mipmapped) {
+      setMipmapping(zoom < 1.0);
+   }
    emit zoomChanged(zoom);
    resize(videoSize*zoom);
 }
@@ -755,38 +935,73 @@ void VideoWidget::setZoom(qreal newZoom) {
   * @sa void seek(int frame)
   */
 void VideoWidget::showNextFrame() {
-   /*
-   const int nextFrame = capture.get(CV_CAP_PROP_POS_FRAMES);
-   const int maxFrames = capture.get(CV_CAP_PROP_FRAME_COUNT);
-   if (nextFrame >= maxFrames) {
-      play(false);
-      return;
-   }
-   currentFrame = nextFrame;
-   emit currentFrameChanged(currentFrame);
-
-   cv::Mat cvImage;
-   capture >> cvImage;
-   updateTexture(cvImage);
-
-   hitArea = NONE;
-   updateData();
-   updateGL();
- */
    seek(currentFrame+1);
 }
 
-/** Simply calls seek(currentFrame-1)
+/** Calls seek(currentFrame-1) unless the current frame is still being decoded,
+  * so holding the previous-frame button can't outrun the decoder. A frame the
+  * decoder failed on doesn't block stepping backwards.
   * @sa void seek(int frame)
   */
 void VideoWidget::showPreviousFrame() {
-   /*
-      capture.set(CV_CAP_PROP_POS_FRAMES, currentFrame-1.0);
-      showNextFrame();
-   */
+   if (shownFrame != currentFrame && decoder->isPending(currentFrame)) {
+      return;
+   }
    seek(currentFrame-1);
 }
 
+/** The image gets uploaded to the texture and added to the frame cache.
+  */
+void VideoWidget::showFrame(int frame, cv::Mat const & mat) {
+   makeCurrent();
+   updateTexture(mat);
+   shownFrame = frame;
+   shownImage = mat;
+   if (cacheEnabled && !fCache.contains(frame)) {
+      fCache.insert(frame, mat);
+      updateCacheStats();
+   }
+   updateGL();
+}
+
+/** A solid line connects the centers of consecutive single boxes, a stippled
+  * line leads to each key box from the preceding box.
+  */
+void VideoWidget::updateCenterline() {
+   centerVertices.clear();
+   centerFrames.clear();
+   solidIndices.clear();
+   stippledIndices.clear();
+   if (selectedObj) {
+      QVector<PackedBBox> const & objectBBoxes = selectedObj->getBBoxes();
+      centerVertices.reserve(2*objectBBoxes.size());
+      centerFrames.reserve(objectBBoxes.size());
+      int prevFrameNumber = objectBBoxes.isEmpty() ? 0 : objectBBoxes.first().framenumber;
+      foreach (PackedBBox const & bbox, objectBBoxes) {
+         const GLuint i = centerFrames.size();
+         if (i > 0 && bbox.type==BBox::SINGLE && bbox.framenumber==prevFrameNumber+1) {
+            solidIndices << i-1 << i;
+         }
+         else if (i > 0 && bbox.type==BBox::KEYBOX) {
+            stippledIndices << i-1 << i;
+         }
+         centerVertices << bbox.rect.center().x() << bbox.rect.center().y();
+         centerFrames << bbox.framenumber;
+         prevFrameNumber = bbox.framenumber;
+      }
+   }
+
+   if (gl.bufferObjects) {
+      if (!centerBuffer) {
+         gl.genBuffers(1, &centerBuffer);
+      }
+      gl.bindBuffer(GL_ARRAY_BUFFER, centerBuffer);
+      gl.bufferData(GL_ARRAY_BUFFER, centerVertices.size()*sizeof(GLfloat), centerVertices.constData(), GL_DYNAMIC_DRAW);
+      gl.bindBuffer(GL_ARRAY_BUFFER, 0);
+   }
+   centerlineDirty = false;
+}
+
 /** If it's over a handle of the selected box it gets changed to a resize cursor
   * else it's reset to the default cursor.
   */
@@ -830,23 +1045,144 @@ void VideoWidget::updateCursor() {
    }
 }
 
+/** Each box consists of four separate lines, so all boxes can be drawn with a
+  * single call. Without buffer objects the vertices are drawn from client
+  * memory.
+  */
+void VideoWidget::updateBoxBatch() {
+   boxVertices.clear();
+   boxVertices.reserve(bboxes.size()*8);
+   foreach (BBox const & bbox, bboxes) {
+      if (selectedObj && bbox.objectID == selectedObj->getID()) {
+         continue;
+      }
+      BoxVertex vertex;
+      switch (bbox.type) {
+      case BBox::SINGLE:
+         vertex.r = 102; vertex.g = 194; vertex.b = 165;
+         break;
+      case BBox::KEYBOX:
+         vertex.r = 252; vertex.g = 141; vertex.b = 98;
+         break;
+      case BBox::VIRTUAL:
+         vertex.r = 141; vertex.g = 160; vertex.b = 203;
+         break;
+      default:
+         continue;
+      }
+      vertex.a = 255;
+
+      const GLfloat corners[8] = { GLfloat(bbox.rect.left()), GLfloat(bbox.rect.bottom()),
+                                   GLfloat(bbox.rect.right()), GLfloat(bbox.rect.bottom()),
+                                   GLfloat(bbox.rect.right()), GLfloat(bbox.rect.top()),
+                                   GLfloat(bbox.rect.left()), GLfloat(bbox.rect.top())};
+      for (int i=0; i<4; ++i) {
+         vertex.x = corners[2*i];
+         vertex.y = corners[2*i+1];
+         boxVertices << vertex;
+         vertex.x = corners[(2*i+2)%8];
+         vertex.y = corners[(2*i+3)%8];
+         boxVertices << vertex;
+      }
+   }
+
+   if (gl.bufferObjects) {
+      if (!boxBuffer) {
+         gl.genBuffers(1, &boxBuffer);
+      }
+      gl.bindBuffer(GL_ARRAY_BUFFER, boxBuffer);
+      gl.bufferData(GL_ARRAY_BUFFER, boxVertices.size()*sizeof(BoxVertex), boxVertices.constData(), GL_DYNAMIC_DRAW);
+      gl.bindBuffer(GL_ARRAY_BUFFER, 0);
+   }
+   boxBatchDirty = false;
+}
+
 /** This should be done whenever the data changes and the cached pointers could
   * be invalid.
   */
 void VideoWidget::updateData() {
    bboxes = data->getBBoxes(currentFrame);
+   bboxesDirty = false;
+   bboxGridDirty = true;
+   boxBatchDirty = true;
    if (selectedObj) {
       selectedBBox = selectedObj->getBBoxPointer(currentFrame);
    }
    updateGL();
 }
 
-/** \note OpenCV uses BGR, OpenGL uses RGB.
+/** The statistics change with every frame during playback, so they only get
+  * emitted by emitStats() once \ref statsTimer times out.
+  */
+void VideoWidget::updateDecoderStats() {
+   decoderStatsDirty = true;
+   if (!statsTimer->isActive()) {
+      statsTimer->start();
+   }
+}
+
+/** Like the decoder statistics these get emitted by emitStats().
+  * @sa void updateDecoderStats()
+  */
+void VideoWidget::updateCacheStats() {
+   cacheStatsDirty = true;
+   if (!statsTimer->isActive()) {
+      statsTimer->start();
+   }
+}
+
+/** The mipmaps add a third to the memory of the texture.
   */
-void VideoWidget::updateTexture(cv::Mat const & mat) const {
-   glEnable(GL_TEXTURE_2D);
-   glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, mat.cols, mat.rows, GL_BGR, GL_UNSIGNED_BYTE, (GLubyte*)mat.data);
-   glDisable(GL_TEXTURE_2D);
+void VideoWidget::updateTextureStats() {
+   const bool hasMipmaps = mipmapped && textureTarget != GL_TEXTURE_RECTANGLE_ARB;
+   qint64 bytes = qint64(textureSize.width())*textureSize.height()*3;
+   if (hasMipmaps) {
+      bytes += bytes/3;
+   }
+   QString kind = tr("POT");
+   if (textureTarget == GL_TEXTURE_RECTANGLE_ARB) {
+      kind = tr("rectangle");
+   }
+   else if (gl.npotTextures) {
+      kind = tr("NPOT");
+   }
+   emit textureStatsChanged(tr("Texture: %1x%2 %3%4, %5 MB")
+                            .arg(textureSize.width())
+                            .arg(textureSize.height())
+                            .arg(kind)
+                            .arg(hasMipmaps ? tr(" + mipmaps") : QString())
+                            .arg(bytes/(1024.0*1024.0), 0, 'f', 1));
+}
+
+/** If pixel buffer objects are available, the image gets copied to the next
+  * one of the \ref pixelBuffers and the texture is updated from there, so the
+  * transfer to the texture happens asynchronously. Each buffer's storage is
+  * orphaned before mapping it, so this never waits for a pending transfer.
+  * Otherwise the image gets uploaded directly.
+  * \note OpenCV uses BGR, OpenGL uses RGB.
+  */
+void VideoWidget::updateTexture(cv::Mat const & mat) {
+   glEnable(textureTarget);
+   if (gl.pixelBufferObjects) {
+      const int rowBytes = mat.cols*mat.elemSize();
+      pixelBufferIndex = (pixelBufferIndex+1)%3;
+      gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[pixelBufferIndex]);
+      gl.bufferData(GL_PIXEL_UNPACK_BUFFER, rowBytes*mat.rows, NULL, GL_STREAM_DRAW);
+      GLubyte * pixels = (GLubyte*)gl.mapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+      if (pixels) {
+         for (int row=0; row<mat.rows; ++row) {
+            memcpy(pixels+row*rowBytes, mat.ptr(row), rowBytes);
+         }
+         gl.unmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+         glTexSubImage2D(textureTarget, 0, 0, 0, mat.cols, mat.rows, GL_BGR, GL_UNSIGNED_BYTE, 0);
+         gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+         glDisable(textureTarget);
+         return;
+      }
+      gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+   }
+   glTexSubImage2D(textureTarget, 0, 0, 0, mat.cols, mat.rows, GL_BGR, GL_UNSIGNED_BYTE, (GLubyte*)mat.data);
+   glDisable(textureTarget);
 }
 
 /** Scroll up: Zoom in - Scroll down: Zoom out
@@ -902,60 +1238,83 @@ void VideoWidget::toggleCache(){
    }
 }
 
+/** The cache is configured by its memory budget, the dialog shows how many
+  * frames of the current video fit into it.
+  */
 void VideoWidget::setCacheProperties(){
-   int size;
-   if (videoSize.isValid()){
-      size = (int)((float)cacheSize*(float)videoSize.width()*(float)videoSize.height()*3.0/(1024.0*1024.0));
-      cacheSizeFactor = (float)(videoSize.width()*videoSize.height());
-   }else{
-      size=0;
-      cacheSizeFactor=0.0;
-   }
-
    QDialog * cacheSettingsWidget = new QDialog();
    QFormLayout * settingsLayout = new QFormLayout(cacheSettingsWidget);
    QSpinBox * cacheSizeBox = new QSpinBox();
-   QLabel * sizeInMb =  new QLabel(QString::number(size) + QString(" MB"));
+   QSpinBox * decodeAheadBox = new QSpinBox();
+   QLabel * usageLabel = new QLabel(tr("%1 MB in %2 frames")
+                                    .arg(fCache.getUsage()/1024)
+                                    .arg(fCache.count()));
    QLabel * newSizeLabel = new QLabel();
    QPushButton *okBut = new QPushButton(tr("Ok"));
    QPushButton *cancelBut = new QPushButton(tr("Cancel"));
 
    cacheSettingsWidget->setWindowTitle(tr("Set Cache Size properties"));
 
-   cacheSizeBox->setMinimum(5);
-   cacheSizeBox->setValue(cacheSize);
+   cacheSizeBox->setRange(16, 16384);
+   cacheSizeBox->setSingleStep(16);
+   cacheSizeBox->setValue(fCache.getBudget());
+   decodeAheadBox->setRange(1, 256);
+   decodeAheadBox->setValue(decoder->getRingSize());
 
    connect(cacheSizeBox, SIGNAL(valueChanged(int)), this, SLOT(setCacheSizeText(int)));
    connect(this, SIGNAL(cacheSizeChanged(QString)), newSizeLabel, SLOT(setText(QString)));
    connect(cancelBut, SIGNAL(clicked()), cacheSettingsWidget, SLOT(reject()));
    connect(okBut, SIGNAL(clicked()), cacheSettingsWidget, SLOT(accept()));
 
-   settingsLayout->addRow("Current Cache size: ", sizeInMb);
-   settingsLayout->addRow("Cache size in Frames:", cacheSizeBox);
+   settingsLayout->addRow("Current cache usage: ", usageLabel);
+   settingsLayout->addRow("Cache size in MB:", cacheSizeBox);
    settingsLayout->addRow("New cache size:", newSizeLabel);
+   settingsLayout->addRow("Decode ahead in Frames:", decodeAheadBox);
    settingsLayout->addRow(okBut, cancelBut);
 
-   setCacheSizeText(cacheSize);
+   setCacheSizeText(cacheSizeBox->value());
 
    if (cacheSettingsWidget->exec() == QDialog::Accepted){
       setCacheSize(cacheSizeBox->value());
+      setDecodeAhead(decodeAheadBox->value());
    }
    cacheSettingsWidget->deleteLater();
 }
 
-/** The cahce also gets cleared
+/** Cached frames are kept, only the least recently used ones get evicted if
+  * the new budget is smaller.
   */
-void VideoWidget::setCacheSize(int newSize){
-   cacheSize = newSize;
-   clearFrameCache();
+void VideoWidget::setCacheSize(int megabytes){
+   fCache.setBudget(megabytes);
+   updateCacheStats();
+}
+
+/** The decoder's ring gets resized, frames already decoded are kept.
+  */
+void VideoWidget::setDecodeAhead(int frames) {
+   decoder->setRingSize(frames);
+   updateDecoderStats();
 }
 
+/** The text contains the number of frames of the current video fitting into
+  * \a size MB.
+  */
 void VideoWidget::setCacheSizeText(int size){
-   emit cacheSizeChanged(QString::number((int)(((float)size *cacheSizeFactor *3.0)/(1024.0*1024.0)))+ QString(" MB"));
+   const qint64 frameBytes = qint64(videoSize.width())*videoSize.height()*3;
+   if (frameBytes > 0) {
+      emit cacheSizeChanged(tr("%1 frames").arg(qint64(size)*1024*1024/frameBytes));
+   }
+   else {
+      emit cacheSizeChanged(tr("No video opened"));
+   }
 }
 
+/** The statistics get reset, too.
+  */
 void VideoWidget::clearFrameCache(){
    fCache.clear();
+   fCache.resetStatistics();
+   updateCacheStats();
 }
 
 void VideoWidget::toggleCenterlines(){
@@ -1,12 +1,18 @@
 #ifndef VIDEOWIDGET_H
 #define VIDEOWIDGET_H
 
+#include <QtCore/QTime>
+#include <QtCore/QVector>
 #include <QtOpenGL/QGLWidget>
 #include <opencv2/highgui/highgui.hpp>
 #include <QtGui/QLabel>
+#include "bboxgrid.h"
+#include "framecache.h"
+#include "glextensions.h"
 #include "types.h"
 
 class DataWidget;
+class FrameDecoder;
 
 /// Class managing the video data and doing all the rendering.
 /** The GL widget can load video files using OpenCV and can render it and the
@@ -33,6 +39,12 @@ class VideoWidget : public QGLWidget {
       BOTTOMRIGHT ///< Bottom right handle was hit
    };
 
+   /// Vertex of the batched bounding boxes
+   struct BoxVertex {
+      GLfloat x, y;       ///< Position in video coordinates
+      GLubyte r, g, b, a; ///< Color of the box
+   };
+
 public:
    /// Ctor which takes a pointer to a DataWidget
    explicit VideoWidget(DataWidget * data, QWidget * parent = 0);
@@ -75,6 +87,21 @@ signals:
    void maxFramesChanged(int n);
    /// Emitted whenever the size of the framecache changes
    void cacheSizeChanged(QString newCacheSizeText);
+   /// Emitted whenever the state of the frame cache changes
+   /** The \a text contains the memory usage and the hit, miss and eviction
+     * counters and is meant to be shown in the status bar.
+     */
+   void cacheStatsChanged(QString text);
+   /// Emitted whenever the state of the decoder changes
+   /** The \a text contains the decode-ahead depth and the number of dropped
+     * frames and is meant to be shown in the status bar.
+     */
+   void decoderStatsChanged(QString text);
+   /// Emitted whenever the frame texture changes
+   /** The \a text contains the kind and memory usage of the texture and is
+     * meant to be shown in the status bar.
+     */
+   void textureStatsChanged(QString text);
    /// Emitted with false whenever a initiated box creation gets aborted.
    /** This notation is used so it can connect directly to a setChecked(bool)
      * slot of a QAction.
@@ -112,18 +139,22 @@ public slots:
    void changeSelection(int id);
    /// Rerequests the cached data from the DataWidget
    void updateData();
+   /// Marks the cached data as outdated without rerequesting it
+   void invalidateData();
    /// Sets the \ref availableSize to \a newSize
    void setAvailableSize(QSize newSize);
    /// Toggles frame caching.
    void toggleCache();
    /// Shows a dialog to edit the cache settings.
    void setCacheProperties();
-   /// Sets the frame cahce size to \a newSize
-   void setCacheSize(int newSize);
+   /// Sets the frame cache budget to \a megabytes
+   void setCacheSize(int megabytes);
    /// Updates the frame cache size label of the properties dialog.
    void setCacheSizeText(int size);
    /// Clears the frame cache.
    void clearFrameCache();
+   /// Sets the number of frames decoded ahead to \a frames
+   void setDecodeAhead(int frames);
    /// Toggles the visibilit of the centerlines used to trace objects
    void toggleCenterlines();
 
@@ -147,19 +178,45 @@ private:
    qreal zoom;                ///< The current zoomfactor
    QSizeF texCoords;          ///< The boundary of the texture coordinates to render the video data
    GLuint currentTexture;     ///< OpenGL name of the texture holding the current frame
+   GLenum textureTarget;      ///< Target of the frame texture, depends on the supported texture sizes
+   QSize textureSize;         ///< Size of the frame texture
+   bool mipmapped;            ///< Indicates whether mipmaps get generated for the frame texture
+   GLExtensions gl;           ///< OpenGL functions beyond version 1.1
+   GLuint pixelBuffers[3];    ///< Pixel buffer objects used round robin to upload the frames
+   int pixelBufferIndex;      ///< Index of the last used pixel buffer object
+   cv::Mat shownImage;        ///< The image data of the \ref shownFrame
    int currentFrame;          ///< The number of the currently shown frame
    Object * selectedObj;      ///< The currently selected object
-   BBox * selectedBBox;       ///< The currently selected bounding box
+   PackedBBox * selectedBBox; ///< The currently selected bounding box, invalidated by any box added to or removed from the \ref selectedObj
    Hitarea hitArea;           ///< The area hitten by a click on a bounding box
    QPoint hitPos;             ///< The point hitten by the mouse on the video
    QList<BBox> bboxes;        ///< List of currently visible bounding boxes
-   cv::VideoCapture capture;  ///< The OpenCV capture holding the video data
+   bool bboxesDirty;          ///< Indicates that the \ref bboxes may be outdated
+   BBoxGrid bboxGrid;         ///< Spatial index over the \ref bboxes used for hit testing
+   bool bboxGridDirty;        ///< Indicates that the \ref bboxGrid has to be rebuilt
+   QVector<BoxVertex> boxVertices; ///< Lines of all visible boxes except the selected object's
+   GLuint boxBuffer;          ///< Vertex buffer object holding the \ref boxVertices
+   bool boxBatchDirty;        ///< Indicates that the \ref boxVertices have to be rebuilt
+   int centerlineID;                ///< ID of the object the centerline geometry was built for
+   QVector<GLfloat> centerVertices; ///< Centers of all boxes of the object with the \ref centerlineID
+   QVector<int> centerFrames;       ///< Framenumbers belonging to the \ref centerVertices
+   QVector<GLuint> solidIndices;    ///< Pairs of centers connected by solid lines
+   QVector<GLuint> stippledIndices; ///< Pairs of centers connected by stippled lines
+   GLuint centerBuffer;       ///< Vertex buffer object holding the \ref centerVertices
+   bool centerlineDirty;      ///< Indicates that the centerline has to be rebuilt
+   int centerPatchBegin;      ///< First center changed since the last upload
+   int centerPatchEnd;        ///< Center after the last one changed since the last upload
+   FrameDecoder * decoder;    ///< The decoder thread holding the video data
+   int shownFrame;            ///< The number of the frame currently uploaded to the texture
    DataWidget * data;         ///< Pointer to the tracking data
    QTimer * timer;            ///< Timer for video playback
-   QMap<int, cv::Mat> fCache; ///< FrameCache for faster scrollback!
+   QTimer * statsTimer;       ///< Timer limiting how often the statistics get emitted
+   bool decoderStatsDirty;    ///< Indicates that the decoder statistics have to be emitted
+   bool cacheStatsDirty;      ///< Indicates that the cache statistics have to be emitted
+   QTime playTime;            ///< Time elapsed since the playback started
+   int playStartFrame;        ///< The number of the frame the playback started at
+   FrameCache fCache;         ///< FrameCache for faster scrollback!
    bool cacheEnabled;         ///< Indicates whether or not the framecaching should be active
-   int cacheSize;             ///< The cache size
-   int cacheSizeFactor;       ///< The cache size factor
 
    /// Initialization after context creation
    void initializeGL();
@@ -171,20 +228,48 @@ private:
    void renderCurrentFrame() const;
    /// Renders a bounding box
    void renderBBox(BBox const & bbox, bool active = false) const;
+   /// Renders all visible bounding boxes except the selected object's at once
+   void renderBoxBatch();
+   /// Rebuilds the \ref boxVertices from the \ref bboxes
+   void updateBoxBatch();
    /// Renders the centerline for the active object
-   void renderCenterline() const;
+   void renderCenterline();
+   /// Rebuilds the centerline geometry of the \ref selectedObj
+   void updateCenterline();
+   /// Moves the center of the box of the selected object at \a bbox's frame to the center of \a bbox
+   void patchCenterline(PackedBBox const & bbox);
    /// Renders the currently selected object
-   void renderSelectedObject() const;
+   void renderSelectedObject();
    /// Recreates the frame texture with the specified size
    void resizeTexture();
    /// Uploads the frame in \a mat to the frame texture
-   void updateTexture(cv::Mat const & mat) const;
+   void updateTexture(cv::Mat const & mat);
+   /// Enables or disables the mipmap generation for the frame texture
+   void setMipmapping(bool enabled);
+   /// Shows the image \a mat of the frame with the number \a frame
+   void showFrame(int frame, cv::Mat const & mat);
+   /// Schedules emitting \ref decoderStatsChanged with the current decoder state
+   void updateDecoderStats();
+   /// Schedules emitting \ref cacheStatsChanged with the current cache state
+   void updateCacheStats();
+   /// Emits \ref textureStatsChanged with the current texture state
+   void updateTextureStats();
    /// Updates the cursor according to its context
    void updateCursor();
    /// Determines which Hitarea (handle) of the \a rect was hitten by the cursors \a pos
    Hitarea isHit(QRect const & rect, QPoint const & pos) const;
    /// Sets the zoom level to \a newZoom
    void setZoom(qreal newZoom);
+
+private slots:
+   /// Shows the decoded \a frame if it is the current one
+   void frameDecoded(int frame);
+   /// Advances the playback according to the elapsed time
+   void playbackTick();
+   /// Emits the statistics scheduled by updateDecoderStats() and updateCacheStats()
+   void emitStats();
+   /// Updates the centerline and the \ref selectedBBox if they belong to the object with the given \a objectID
+   void objectChanged(int objectID);
 };
 
 #endif // VIDEOWIDGET_H